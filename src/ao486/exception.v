@@ -164,7 +164,7 @@ reg [1:0]   last_type;
 
 reg [31:0]  trap_eip;
 
-reg         shutdown;
+reg         shutdown /* verilator public */;
 
 reg         interrupt_load;
 reg         interrupt_string_in_progress;
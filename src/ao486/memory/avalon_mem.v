@@ -59,6 +59,14 @@ module avalon_mem(
     output      [31:0]  readcode_partial,
     //END
     
+    //RESP:
+    input               readline_do,
+    output              readline_done,
+    
+    input       [31:0]  readline_address,
+    output      [31:0]  readline_partial,
+    //END
+    
     output      [27:2]  snoop_addr,
     output      [31:0]  snoop_data,
     output       [3:0]  snoop_be,
@@ -106,6 +114,7 @@ localparam [2:0] STATE_READ      = 3'd2;
 localparam [2:0] STATE_READ_CODE = 3'd3;
 localparam [2:0] STATE_WRITE_DMA = 3'd4;
 localparam [2:0] STATE_READ_DMA  = 3'd5;
+localparam [2:0] STATE_READ_LINE = 3'd6;
 
 //------------------------------------------------------------------------------
 wire    [1:0]   readburst_dword_length;
@@ -148,6 +157,7 @@ wire [3:0] read_burst_byteenable = {len_be4[0], len_be4[1], len_be4[2], len_be4[
 
 assign readburst_data = {avm_readdata, ~&save_readburst ? avm_readdata : bus_0, ~save_readburst[1] ? avm_readdata : bus_1};
 assign readcode_partial = avm_readdata;
+assign readline_partial = avm_readdata;
 
 //------------------------------------------------------------------------------
 
@@ -197,11 +207,13 @@ assign dma_readdatavalid = state == STATE_READ_DMA  && avm_readdatavalid;
 assign writeburst_done   = state == STATE_IDLE      && writeburst_do && ~avm_waitrequest;
 assign readburst_done    = state == STATE_READ      && counter == 3'd0 && avm_readdatavalid;
 assign readcode_done     = state == STATE_READ_CODE && avm_readdatavalid;
+assign readline_done     = state == STATE_READ_LINE && avm_readdatavalid;
 
 assign avm_address = 
    (state != STATE_IDLE) ? writeaddr_next :
    writeburst_do         ? writeburst_address[31:2] :
    readburst_do          ? readburst_address[31:2] :
+   readline_do           ? readline_address[31:2] :
    readcode_do           ? readcode_address[31:2] :
                            dma_address[23:2];
 
@@ -215,17 +227,19 @@ assign avm_byteenable =
    (state != STATE_IDLE)         ? byteenable_next :
    writeburst_do                 ? writeburst_byteenable_0 : 
    (readburst_do || readcode_do) ? read_burst_byteenable : 
+   readline_do                   ? 4'b1111 :
    dma_16bit                     ? {dma_address[1],dma_address[1],~dma_address[1],~dma_address[1]} :
                                    (4'b0001 << dma_address[1:0]);
 
 assign avm_burstcount = 
    readburst_do ? { 2'b0, readburst_dword_length }  :
+   readline_do  ? 4'd8 :
    readcode_do  ? 4'd8 :
                   4'd1;
 
-wire dma_start = ~(writeburst_do | readburst_do | readcode_do);
+wire dma_start = ~(writeburst_do | readburst_do | readline_do | readcode_do);
 assign avm_write = rst_n && ((state == STATE_IDLE && (writeburst_do || (dma_write && dma_start))) || state == STATE_WRITE);
-assign avm_read  = rst_n && state == STATE_IDLE && ~writeburst_do && (readburst_do || readcode_do || dma_read);
+assign avm_read  = rst_n && state == STATE_IDLE && ~writeburst_do && (readburst_do || readline_do || readcode_do || dma_read);
 
 assign snoop_addr = avm_address[27:2];
 assign snoop_data = avm_writedata;
@@ -260,6 +274,10 @@ always @(posedge clk) begin
                   counter        <= readburst_dword_length - 3'd1;
                   save_readburst <= readburst_dword_length;
                end
+               else if (readline_do) begin
+                  state   <= STATE_READ_LINE;
+                  counter <= 3'd7;
+               end
                else if (readcode_do) begin
                   state   <= STATE_READ_CODE;
                   counter <= 3'd7;
@@ -294,6 +312,12 @@ always @(posedge clk) begin
             if(counter == 3'd0) state <= STATE_IDLE;
          end
 
+		STATE_READ_LINE:
+         if (avm_readdatavalid) begin
+            counter <= counter - 3'd1;
+            if(counter == 3'd0) state <= STATE_IDLE;
+         end
+
 		STATE_WRITE_DMA:
 			begin
 				state <= STATE_IDLE;
@@ -333,6 +333,74 @@ wire            snoop_we;
 
 //------------------------------------------------------------------------------
 
+wire            readburst_do;
+wire            readburst_done;
+wire [31:0]     readburst_address;
+wire [3:0]      readburst_length;
+wire [63:0]     readburst_data;
+
+wire            readline_do;
+wire            readline_done;
+wire [31:0]     readline_address;
+wire [31:0]     readline_partial;
+
+`ifdef L1_DCACHE
+
+`ifndef L1_DCACHE_LINES
+`define L1_DCACHE_LINES 128
+`endif
+`ifndef L1_DCACHE_WAYS
+`define L1_DCACHE_WAYS 2
+`endif
+
+l1_dcache #(
+    .LINES                      (`L1_DCACHE_LINES),
+    .ASSOCIATIVITY              (`L1_DCACHE_WAYS)
+)
+dcache_inst(
+    .CLK                        (clk),
+    .RESET                      (~rst_n),
+    
+    .CPU_REQ                    (resp_dcacheread_do),           //input
+    .CPU_ADDR                   (resp_dcacheread_address),      //input [31:0]
+    .CPU_LENGTH                 (resp_dcacheread_length),       //input [3:0]
+    .CPU_CACHE_DISABLE          (resp_dcacheread_cache_disable),//input
+    .CPU_WRITE_PENDING          (resp_dcachewrite_do),          //input
+    .CPU_DONE                   (resp_dcacheread_done),         //output
+    .CPU_DATA                   (resp_dcacheread_data),         //output [63:0]
+    
+    .MEM_READ_REQ               (readburst_do),                 //output
+    .MEM_READ_ADDR              (readburst_address),            //output [31:0]
+    .MEM_READ_LENGTH            (readburst_length),             //output [3:0]
+    .MEM_READ_DONE              (readburst_done),               //input
+    .MEM_READ_DATA              (readburst_data),               //input [63:0]
+    
+    .MEM_FILL_REQ               (readline_do),                  //output
+    .MEM_FILL_ADDR              (readline_address),             //output [31:0]
+    .MEM_FILL_VALID             (readline_done),                //input
+    .MEM_FILL_DATA              (readline_partial),             //input [31:0]
+    
+    .snoop_addr                 (snoop_addr),
+    .snoop_data                 (snoop_data),
+    .snoop_be                   (snoop_be),
+    .snoop_we                   (snoop_we)
+);
+
+`else
+
+assign readburst_do          = resp_dcacheread_do;
+assign readburst_address     = resp_dcacheread_address;
+assign readburst_length      = resp_dcacheread_length;
+assign resp_dcacheread_done  = readburst_done;
+assign resp_dcacheread_data  = readburst_data;
+
+assign readline_do           = 1'b0;
+assign readline_address      = 32'd0;
+
+`endif
+
+//------------------------------------------------------------------------------
+
 avalon_mem avalon_mem_inst(
     // global
     .clk                        (clk),
@@ -348,12 +416,20 @@ avalon_mem avalon_mem_inst(
     //END
     
     //RESP:
-    .readburst_do               (resp_dcacheread_do),           //input
-    .readburst_done             (resp_dcacheread_done),         //output
+    .readburst_do               (readburst_do),                 //input
+    .readburst_done             (readburst_done),               //output
+    
+    .readburst_address          (readburst_address),            //input  [31:0]
+    .readburst_length           (readburst_length),             //input  [3:0]
+    .readburst_data_out         (readburst_data),               //output [63:0]
+    //END
+    
+    //RESP:
+    .readline_do                (readline_do),                  //input
+    .readline_done              (readline_done),                //output
     
-    .readburst_address          (resp_dcacheread_address),      //input  [31:0]
-    .readburst_length           (resp_dcacheread_length),       //input  [3:0]
-    .readburst_data_out         (resp_dcacheread_data),         //output [63:0]
+    .readline_address           (readline_address),             //input  [31:0]
+    .readline_partial           (readline_partial),             //output [31:0]
     //END
 
     //RESP:
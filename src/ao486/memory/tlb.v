@@ -306,7 +306,22 @@ tlb_memtype tlb_memtype_inst(
 wire tlbregs_tlbflushsingle_do;
 wire tlbregs_tlbflushall_do;
 
-tlb_regs tlb_regs_inst(
+`ifndef TLB_ENTRIES
+`define TLB_ENTRIES 32
+`endif
+`ifndef TLB_WAYS
+`define TLB_WAYS `TLB_ENTRIES
+`endif
+`ifndef TLB_REPLACEMENT
+`define TLB_REPLACEMENT 0
+`endif
+
+tlb_regs #(
+    .ENTRIES                    (`TLB_ENTRIES),
+    .WAYS                       (`TLB_WAYS),
+    .REPLACEMENT                (`TLB_REPLACEMENT)
+)
+tlb_regs_inst(
     .clk                        (clk),
     .rst_n                      (rst_n),
     
@@ -1533,4 +1548,33 @@ assign dcacheread_cache_disable =
     (cond_43 && cond_12 && ~cond_28 && cond_29)? (    cr0_cd || pte[4] || memtype_cache_disable) :
     1'd0;
 
+`ifdef VERILATOR
+// Counters for the simulation harness. Every check state with paging on
+// looks up the TLB once. A miss (including a write to a page not yet marked
+// dirty) starts a page walk. Walk cycles are spent loading the PDE/PTE and
+// writing back the accessed/dirty bits. After the walk the request goes
+// through STATE_RETRY and looks up the TLB again; that second lookup is part
+// of the miss, not a hit.
+reg [63:0] stat_hits        /* verilator public */;
+reg [63:0] stat_misses      /* verilator public */;
+reg [63:0] stat_walk_cycles /* verilator public */;
+reg        stat_retry;
+
+always @(posedge clk) begin
+    if(rst_n == 1'b0) begin
+        stat_hits        <= 64'd0;
+        stat_misses      <= 64'd0;
+        stat_walk_cycles <= 64'd0;
+        stat_retry       <= `FALSE;
+    end
+    else begin
+        if(state == STATE_RETRY)                                        stat_retry       <= `TRUE;
+        else if(translate_do)                                           stat_retry       <= `FALSE;
+        if(translate_do && translate_valid && ~(stat_retry))            stat_hits        <= stat_hits + 1'd1;
+        if(translate_do && ~(translate_valid))                          stat_misses      <= stat_misses + 1'd1;
+        if(state >= STATE_LOAD_PDE && state <= STATE_SAVE_PTE)          stat_walk_cycles <= stat_walk_cycles + 1'd1;
+    end
+end
+`endif
+
 endmodule
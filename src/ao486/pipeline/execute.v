@@ -203,6 +203,7 @@ module execute(
     
     output reg  [31:0]  exe_eip,
     output reg  [3:0]   exe_consumed,
+    output reg          exe_last,
     
     //rd pipeline
     output              exe_busy,
@@ -216,6 +217,7 @@ module execute(
     input               rd_prefix_group_1_lock,
     input               rd_prefix_2byte,
     input       [3:0]   rd_consumed,
+    input               rd_last,
     input               rd_is_8bit,
     input       [6:0]   rd_cmd,
     input       [3:0]   rd_cmdex,
@@ -347,6 +349,7 @@ always @(posedge clk) begin if(rst_n == 1'b0) exe_prefix_group_1_rep   <= 2'd0;
 always @(posedge clk) begin if(rst_n == 1'b0) exe_prefix_group_1_lock  <= `FALSE;    else if(e_load) exe_prefix_group_1_lock  <= rd_prefix_group_1_lock;  end
 always @(posedge clk) begin if(rst_n == 1'b0) exe_prefix_2byte         <= `FALSE;    else if(e_load) exe_prefix_2byte         <= rd_prefix_2byte;         end
 always @(posedge clk) begin if(rst_n == 1'b0) exe_consumed             <= 4'd0;      else if(e_load) exe_consumed             <= rd_consumed;             end
+always @(posedge clk) begin if(rst_n == 1'b0) exe_last                 <= `FALSE;    else if(e_load) exe_last                 <= rd_last;                 end
 always @(posedge clk) begin if(rst_n == 1'b0) exe_is_8bit              <= `FALSE;    else if(e_load) exe_is_8bit              <= rd_is_8bit;              end
 always @(posedge clk) begin if(rst_n == 1'b0) exe_cmdex                <= 4'd0;      else if(e_load) exe_cmdex                <= rd_cmdex;                end
 always @(posedge clk) begin if(rst_n == 1'b0) exe_modregrm_imm         <= 8'd0;      else if(e_load) exe_modregrm_imm         <= rd_modregrm_imm[7:0];    end
@@ -87,6 +87,7 @@ module microcode(
     output      [2:0]   micro_prefix_group_2_seg,
     output              micro_prefix_2byte,
     output      [3:0]   micro_consumed,
+    output              micro_last,
     output      [2:0]   micro_modregrm_len,
     output              micro_is_8bit,
     output      [6:0]   micro_cmd,
@@ -240,6 +241,11 @@ assign micro_consumed =
     (m_overlay)?        mc_consumed :
                         dec_consumed;
 
+// last micro-op of the instruction: a simple one, or the final step of the overlay
+assign micro_last =
+    (m_overlay)?        mc_cmd_next == `CMD_NULL :
+                        ~(dec_is_complex);
+
 assign micro_eip =
     (task_start)?   task_eip :
     (exc_load)?     exc_eip :
@@ -169,7 +169,7 @@ module pipeline(
     
     output              acflag,
     
-    output      [31:0]  cr3,
+    output      [31:0]  cr3 /* verilator public */,
     
     // prefetch_fifo
     output              prefetchfifo_accept_do,
@@ -370,10 +370,10 @@ assign wr_reset    = exc_wr_reset;
 
 //------------------------------------------------------------------------------
 
-wire [31:0] gdtr_base;
+wire [31:0] gdtr_base /* verilator public */;
 wire [15:0] gdtr_limit;
 
-wire [31:0] idtr_base;
+wire [31:0] idtr_base /* verilator public */;
 wire [15:0] idtr_limit;
 
 wire        es_cache_valid;
@@ -413,7 +413,7 @@ wire        cr0_em;
 wire        cr0_mp;
 wire        cr0_pe;
 
-wire [31:0] cr2;
+wire [31:0] cr2 /* verilator public */;
 
 wire [31:0] eax /* verilator public */;
 wire [31:0] ebx /* verilator public */;
@@ -430,8 +430,8 @@ wire [15:0] ss /* verilator public */;
 wire [15:0] ds /* verilator public */;
 wire [15:0] fs /* verilator public */;
 wire [15:0] gs /* verilator public */;
-wire [15:0] ldtr;
-wire [15:0] tr;
+wire [15:0] ldtr /* verilator public */;
+wire [15:0] tr /* verilator public */;
 
 wire [31:0] dr0;
 wire [31:0] dr1;
@@ -444,6 +444,14 @@ wire        dr6_b12;
 wire [3:0]  dr6_breakpoints;
 wire [31:0] dr7;
 
+`ifdef VERILATOR
+// system registers in architectural layout for the harness, see statehash.cpp
+wire [31:0] eflags /* verilator public */ = { 10'd0, idflag, 2'd0, acflag, vmflag, rflag, 1'b0, ntflag, iopl,
+                                              oflag, dflag, iflag, tflag, sflag, zflag, 1'b0, aflag, 1'b0, pflag, 1'b1, cflag };
+wire [31:0] cr0 /* verilator public */    = { cr0_pg, cr0_cd, cr0_nw, 10'd0, cr0_am, 1'b0, cr0_wp, 10'd0,
+                                              cr0_ne, 1'b1, cr0_ts, cr0_em, cr0_mp, cr0_pe };
+`endif
+
 
 
 //------------------------------------------------------------------------------
@@ -572,6 +580,7 @@ wire        micro_prefix_group_1_lock;
 wire [2:0]  micro_prefix_group_2_seg;
 wire        micro_prefix_2byte;
 wire [3:0]  micro_consumed;
+wire        micro_last;
 wire [2:0]  micro_modregrm_len;
 wire        micro_is_8bit;
 wire [3:0]  micro_cmdex;
@@ -636,6 +645,7 @@ microcode microcode_inst(
     .micro_prefix_group_2_seg      (micro_prefix_group_2_seg),      //output [2:0]
     .micro_prefix_2byte            (micro_prefix_2byte),            //output
     .micro_consumed                (micro_consumed),                //output [3:0]
+    .micro_last                    (micro_last),                    //output
     .micro_modregrm_len            (micro_modregrm_len),            //output [2:0]
     .micro_is_8bit                 (micro_is_8bit),                 //output
     .micro_cmd                     (micro_cmd),                     //output [6:0]
@@ -664,6 +674,7 @@ wire [1:0]  rd_prefix_group_1_rep;
 wire        rd_prefix_group_1_lock;
 wire        rd_prefix_2byte;
 wire        rd_is_8bit;
+wire        rd_last;
 //wire [6:0]  rd_cmd;
 wire [3:0]  rd_cmdex;
 wire [31:0] rd_modregrm_imm;
@@ -825,6 +836,7 @@ read read_inst(
     .micro_prefix_group_2_seg      (micro_prefix_group_2_seg),      //input [2:0]
     .micro_prefix_2byte            (micro_prefix_2byte),            //input
     .micro_consumed                (micro_consumed),                //input [3:0]
+    .micro_last                    (micro_last),                    //input
     .micro_modregrm_len            (micro_modregrm_len),            //input [2:0]
     .micro_is_8bit                 (micro_is_8bit),                 //input
     .micro_cmd                     (micro_cmd),                     //input [6:0]
@@ -842,6 +854,7 @@ read read_inst(
     .rd_prefix_group_1_lock        (rd_prefix_group_1_lock),        //output
     .rd_prefix_2byte               (rd_prefix_2byte),               //output
     .rd_consumed                   (rd_consumed),                   //output [3:0]
+    .rd_last                       (rd_last),                       //output
     .rd_is_8bit                    (rd_is_8bit),                    //output
     .rd_cmd                        (rd_cmd),                        //output [6:0]
     .rd_cmdex                      (rd_cmdex),                      //output [3:0]
@@ -880,6 +893,7 @@ wire        exe_address_32bit;
 wire [1:0]  exe_prefix_group_1_rep;
 wire        exe_prefix_group_1_lock;
 wire [3:0]  exe_consumed_final;
+wire        exe_last;
 wire        exe_is_8bit_final;
 wire [6:0]  exe_cmd;
 wire [3:0]  exe_cmdex;
@@ -1078,6 +1092,7 @@ execute execute_inst(
     
     .exe_eip                       (exe_eip),                       //output [31:0]
     .exe_consumed                  (exe_consumed),                  //output [3:0]
+    .exe_last                      (exe_last),                      //output
                      
     //rd pipeline
     .exe_busy                      (exe_busy),                      //output
@@ -1090,6 +1105,7 @@ execute execute_inst(
     .rd_prefix_group_1_lock        (rd_prefix_group_1_lock),        //input
     .rd_prefix_2byte               (rd_prefix_2byte),               //input
     .rd_consumed                   (rd_consumed),                   //input [3:0]
+    .rd_last                       (rd_last),                       //input
     .rd_is_8bit                    (rd_is_8bit),                    //input
     .rd_cmd                        (rd_cmd),                        //input [6:0]
     .rd_cmdex                      (rd_cmdex),                      //input [3:0]
@@ -1381,6 +1397,7 @@ write write_inst(
     .exe_prefix_group_1_rep        (exe_prefix_group_1_rep),        //input [1:0]
     .exe_prefix_group_1_lock       (exe_prefix_group_1_lock),       //input
     .exe_consumed_final            (exe_consumed_final),            //input [3:0]
+    .exe_last                      (exe_last),                      //input
     .exe_is_8bit_final             (exe_is_8bit_final),             //input
     .exe_cmd                       (exe_cmd),                       //input [6:0]
     .exe_cmdex                     (exe_cmdex),                     //input [3:0]
@@ -179,6 +179,7 @@ module read(
     input       [2:0]   micro_prefix_group_2_seg,
     input               micro_prefix_2byte,
     input       [3:0]   micro_consumed,
+    input               micro_last,
     input       [2:0]   micro_modregrm_len,
     input               micro_is_8bit,
     input       [6:0]   micro_cmd,
@@ -196,6 +197,7 @@ module read(
     output reg          rd_prefix_group_1_lock,
     output reg          rd_prefix_2byte,
     output reg  [3:0]   rd_consumed,
+    output reg          rd_last,
     output reg          rd_is_8bit,
     output reg  [6:0]   rd_cmd,
     output reg  [3:0]   rd_cmdex,
@@ -395,6 +397,7 @@ always @(posedge clk) begin if(rst_n == 1'b0) rd_prefix_group_1_lock  <= `FALSE;
 always @(posedge clk) begin if(rst_n == 1'b0) rd_prefix_group_2_seg   <= 3'd3;      else if(r_load) rd_prefix_group_2_seg   <= micro_prefix_group_2_seg;   end
 always @(posedge clk) begin if(rst_n == 1'b0) rd_prefix_2byte         <= `FALSE;    else if(r_load) rd_prefix_2byte         <= micro_prefix_2byte;         end
 always @(posedge clk) begin if(rst_n == 1'b0) rd_consumed             <= 4'd0;      else if(r_load) rd_consumed             <= micro_consumed;             end
+always @(posedge clk) begin if(rst_n == 1'b0) rd_last                 <= `FALSE;    else if(r_load) rd_last                 <= micro_last;                 end
 always @(posedge clk) begin if(rst_n == 1'b0) rd_modregrm_len         <= 3'd0;      else if(r_load) rd_modregrm_len         <= micro_modregrm_len;         end
 always @(posedge clk) begin if(rst_n == 1'b0) rd_is_8bit              <= `FALSE;    else if(r_load) rd_is_8bit              <= micro_is_8bit;              end
 always @(posedge clk) begin if(rst_n == 1'b0) rd_cmdex                <= 4'd0;      else if(r_load) rd_cmdex                <= micro_cmdex;                end
@@ -262,6 +262,7 @@ module write(
     input       [1:0]   exe_prefix_group_1_rep,
     input               exe_prefix_group_1_lock,
     input       [3:0]   exe_consumed_final,
+    input               exe_last,
     input               exe_is_8bit_final,
     input       [6:0]   exe_cmd,
     input       [3:0]   exe_cmdex,
@@ -316,6 +317,7 @@ reg         wr_address_32bit;
 reg [1:0]   wr_prefix_group_1_rep;
 reg         wr_prefix_group_1_lock;
 reg         wr_is_8bit;
+reg         wr_last;
 reg [6:0]   wr_cmd;
 reg [3:0]   wr_cmdex;
 reg         wr_dst_is_reg;
@@ -581,6 +583,107 @@ assign wr_string_in_progress_final = wr_string_in_progress || ((wr_debug_init ||
 
 //------------------------------------------------------------------------------
 
+wire [31:0] wr_string_count;
+
+`ifdef VERILATOR
+// Host acceleration of long REP MOVS/STOS, see accel.cpp. When an iteration
+// finishes, the harness may copy the following elements directly in memory
+// and return how many it did. The next iteration then advances ESI/EDI/ECX
+// past all of them, provided it still is the same instruction (ECX and EDI
+// as predicted). The call writes guest RAM and flushes the caches from inside
+// eval(), which needs Verilator's default --threads-dpi pure (non-pure
+// imports are not run concurrently).
+import "DPI-C" function int string_accel(
+    input int       is_movs,
+    input int       size,
+    input int       dflag,
+    input int       address_32bit,
+    input int       paging,
+    input int       ecx,
+    input int       eax,
+    input int       src_linear,
+    input int       esi,
+    input int       esi_next,
+    input int       edi_next,
+    input longint   es_cache,
+    input longint   cs_cache,
+    input longint   ss_cache,
+    input longint   ds_cache,
+    input longint   fs_cache,
+    input longint   gs_cache
+);
+
+reg [31:0] wr_string_skip;
+reg [31:0] wr_string_skip_ecx;
+reg [31:0] wr_string_skip_edi;
+
+always @(posedge clk) begin
+    if(rst_n == 1'b0)   wr_string_skip <= 32'd0;
+    else if(wr_reset)   wr_string_skip <= 32'd0;
+    else if(wr_finished && wr_string_in_progress && (wr_cmd == `CMD_MOVS || wr_cmd == `CMD_STOS) &&
+            ~(wr_interrupt_possible_prepare) && ~(wr_debug_prepare)) begin
+        wr_string_skip <= string_accel(
+            (wr_cmd == `CMD_MOVS)? 1 : 0, (wr_is_8bit)? 1 : (wr_operand_32bit)? 4 : 2, { 31'd0, dflag }, { 31'd0, wr_address_32bit }, { 31'd0, cr0_pg },
+            wr_ecx_final, eax, wr_linear, esi, wr_esi_final, wr_edi_final,
+            es_cache, cs_cache, ss_cache, ds_cache, fs_cache, gs_cache);
+        wr_string_skip_ecx <= wr_ecx_final;
+        wr_string_skip_edi <= wr_edi_final;
+    end
+    else if(wr_finished)   wr_string_skip <= 32'd0;
+end
+
+assign wr_string_count = (wr_string_skip != 32'd0 && ecx == wr_string_skip_ecx && edi == wr_string_skip_edi)? wr_string_skip : 32'd1;
+`else
+assign wr_string_count = 32'd1;
+`endif
+
+`ifdef VERILATOR
+// retired instruction count for the simulation harness; a microcoded
+// instruction (INT, IRET, far CALL, PUSHA, ...) counts once, at its last
+// micro-op, and a REP string instruction when its last iteration finishes
+reg [63:0] retired /* verilator public */;
+
+always @(posedge clk) begin
+    if(rst_n == 1'b0)                                               retired <= 64'd0;
+    else if(wr_finished && wr_last && ~(wr_string_in_progress))     retired <= retired + 64'd1;
+end
+
+// command of the first micro-op of the last instruction retired, e.g.
+// CMD_int for an interrupt or exception entry, CMD_IRET for an IRET
+// (watchdog.cpp, irqstat.cpp)
+reg       wr_insn_first;
+reg [6:0] wr_insn_cmd;
+reg [6:0] retired_cmd /* verilator public */;
+
+always @(posedge clk) begin
+    if(rst_n == 1'b0)                                   wr_insn_first <= `TRUE;
+    else if(wr_reset)                                   wr_insn_first <= `TRUE;
+    else if(wr_finished && ~(wr_string_in_progress))    wr_insn_first <= wr_last;
+    else if(wr_finished)                                wr_insn_first <= `FALSE;
+end
+
+always @(posedge clk) begin
+    if(rst_n == 1'b0)                                   wr_insn_cmd <= `CMD_NULL;
+    else if(wr_finished && wr_insn_first)               wr_insn_cmd <= wr_cmd;
+end
+
+always @(posedge clk) begin
+    if(rst_n == 1'b0)                                               retired_cmd <= `CMD_NULL;
+    else if(wr_finished && wr_last && ~(wr_string_in_progress))     retired_cmd <= (wr_insn_first)? wr_cmd : wr_insn_cmd;
+end
+
+// HLT waiting in the write stage with interrupts disabled; nothing but a
+// reset gets the CPU out of that (watchdog.cpp)
+wire halted_cli /* verilator public */ = wr_ready && wr_hlt_in_progress && ~(iflag);
+
+// interrupt latency attribution (irqstat.cpp): HLT waiting, and a REP string
+// between iterations
+wire halted /* verilator public */ = wr_ready && wr_hlt_in_progress;
+wire string_in_progress /* verilator public */ = wr_string_in_progress;
+`endif
+
+//------------------------------------------------------------------------------
+
 always @(posedge clk) begin
     if(rst_n == 1'b0)   wr_first_cycle <= `FALSE;
     else if(wr_reset)   wr_first_cycle <= `FALSE;
@@ -597,6 +700,7 @@ always @(posedge clk) begin if(rst_n == 1'b0) wr_address_32bit        <= `FALSE;
 always @(posedge clk) begin if(rst_n == 1'b0) wr_prefix_group_1_rep   <= 2'd0;      else if(w_load) wr_prefix_group_1_rep   <= exe_prefix_group_1_rep;   end
 always @(posedge clk) begin if(rst_n == 1'b0) wr_prefix_group_1_lock  <= `FALSE;    else if(w_load) wr_prefix_group_1_lock  <= exe_prefix_group_1_lock;  end
 always @(posedge clk) begin if(rst_n == 1'b0) wr_consumed             <= 4'd0;      else if(w_load) wr_consumed             <= exe_consumed_final;       end
+always @(posedge clk) begin if(rst_n == 1'b0) wr_last                 <= `FALSE;    else if(w_load) wr_last                 <= exe_last;                 end
 always @(posedge clk) begin if(rst_n == 1'b0) wr_is_8bit              <= `FALSE;    else if(w_load) wr_is_8bit              <= exe_is_8bit_final;        end
 always @(posedge clk) begin if(rst_n == 1'b0) wr_cmdex                <= 4'd0;      else if(w_load) wr_cmdex                <= exe_cmdex;                end
 always @(posedge clk) begin if(rst_n == 1'b0) wr_dst_is_reg           <= `FALSE;    else if(w_load) wr_dst_is_reg           <= exe_dst_is_reg;           end
@@ -1487,6 +1591,8 @@ write_string write_string_inst(
     .esi                        (esi),                      //input [31:0]
     .edi                        (edi),                      //input [31:0]
     
+    .wr_string_count            (wr_string_count),          //input [31:0]
+    
     .es_cache                   (es_cache),                 //input [63:0]
     .es_cache_valid             (es_cache_valid),           //input
     .es_base                    (es_base),                  //input [31:0]
@@ -44,6 +44,8 @@ module write_string(
     input       [31:0]  esi,
     input       [31:0]  edi,
     
+    input       [31:0]  wr_string_count,    //elements completed by this iteration, normally 1
+    
     input       [63:0]  es_cache,
     input               es_cache_valid,
     input       [31:0]  es_base,
@@ -65,6 +67,7 @@ module write_string(
 
 //------------------------------------------------------------------------------ string
 wire [31:0] w_string_size;
+wire [31:0] w_string_step;
 wire [31:0] w_esi;
 wire [31:0] w_edi;
 wire [31:0] w_ecx;
@@ -72,9 +75,11 @@ wire [31:0] w_ecx;
 
 assign w_string_size = (wr_is_8bit)? 32'd1 : (wr_operand_16bit)? 32'd2 : 32'd4;
 
-assign w_esi = (dflag)? esi - w_string_size : esi + w_string_size;
-assign w_edi = (dflag)? edi - w_string_size : edi + w_string_size;
-assign w_ecx = ecx - 32'd1;
+assign w_string_step = (wr_is_8bit)? wr_string_count : (wr_operand_16bit)? { wr_string_count[30:0], 1'b0 } : { wr_string_count[29:0], 2'b0 };
+
+assign w_esi = (dflag)? esi - w_string_step : esi + w_string_step;
+assign w_edi = (dflag)? edi - w_string_step : edi + w_string_step;
+assign w_ecx = ecx - wr_string_count;
 
 assign wr_esi_final = (wr_address_16bit)? { esi[31:16], w_esi[15:0] } : w_esi;
 assign wr_edi_final = (wr_address_16bit)? { edi[31:16], w_edi[15:0] } : w_edi;
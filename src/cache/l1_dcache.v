@@ -0,0 +1,384 @@
+// L1 data cache for the ao486 read path (memory.v, L1_DCACHE builds).
+//
+// Sits between link_dcacheread and avalon_mem. Cacheable reads are served
+// from the cache, a miss fills the whole line with one 8-dword burst on the
+// avalon_mem readline port. Reads with cache_disable set (CR0.CD, page PCD,
+// the VGA window from tlb_memtype) and reads above 256MB go to the readburst
+// port unchanged.
+//
+// Write-through: the cache is not on the write path. Every CPU and DMA write
+// that reaches memory shows up on the avalon_mem snoop port, and the cached
+// dword is updated when the line is present. Writes to the ROM segments are
+// not applied, the memory backends drop them while the CPU runs (see
+// rom_area.vh). Snoops are drained before a lookup, and no lookup starts
+// while a CPU write is waiting, so a read always sees the writes issued
+// before it. A write burst during a lookup or fill can overflow the snoop
+// fifo; the whole cache is then invalidated before the next read.
+
+module l1_dcache #(
+	parameter LINES         = 128,  // sets, power of two
+	parameter ASSOCIATIVITY = 2     // ways, power of two, at least 2
+)
+(
+	input             CLK,
+	input             RESET,
+
+	// from link_dcacheread
+	input             CPU_REQ,
+	input      [31:0] CPU_ADDR,
+	input       [3:0] CPU_LENGTH,
+	input             CPU_CACHE_DISABLE,
+	input             CPU_WRITE_PENDING,
+	output            CPU_DONE,
+	output     [63:0] CPU_DATA,
+
+	// uncached reads, avalon_mem readburst
+	output            MEM_READ_REQ,
+	output     [31:0] MEM_READ_ADDR,
+	output      [3:0] MEM_READ_LENGTH,
+	input             MEM_READ_DONE,
+	input      [63:0] MEM_READ_DATA,
+
+	// line fills, avalon_mem readline
+	output            MEM_FILL_REQ,
+	output     [31:0] MEM_FILL_ADDR,
+	input             MEM_FILL_VALID,
+	input      [31:0] MEM_FILL_DATA,
+
+	input      [27:2] snoop_addr,
+	input      [31:0] snoop_data,
+	input       [3:0] snoop_be,
+	input             snoop_we
+);
+
+`include "rom_area.vh"
+
+// cache settings
+localparam LINESIZE_BITS = 3;   // 8 dwords, one readline burst
+localparam LINE_BITS     = $clog2(LINES);
+localparam ASSO_BITS     = (ASSOCIATIVITY > 1) ? $clog2(ASSOCIATIVITY) : 1;
+localparam TAG_BITS      = 26 - LINESIZE_BITS - LINE_BITS;
+localparam RAMSIZEBITS   = LINE_BITS + LINESIZE_BITS;
+
+localparam [2:0]
+	START     = 0,
+	IDLE      = 1,
+	SNOOP     = 2,
+	LOOKUP    = 3,
+	FILL      = 4,
+	READ_DONE = 5,
+	UNCACHED  = 6;
+
+reg [2:0] state;
+
+// address of the dword being looked up or snooped, drives all RAM reads
+reg  [27:2]           read_addr;
+wire [LINE_BITS-1:0]  read_set = read_addr[LINESIZE_BITS+2 +: LINE_BITS];
+wire [TAG_BITS-1:0]   read_tag = read_addr[27 -: TAG_BITS];
+
+reg  [1:0]            word_idx;
+reg  [1:0]            word_last;
+reg  [1:0]            byte_offset;
+reg  [95:0]           read_buf;
+
+reg  [LINESIZE_BITS-1:0] fillcount;
+reg  [ASSO_BITS-1:0]     victim;
+
+reg  [31:0]           snoop_data_r;
+reg  [3:0]            snoop_be_r;
+
+reg  [LINE_BITS-1:0]  start_set;
+
+// RAM outputs
+wire [ASSOCIATIVITY-1:0] tags_valid;
+wire [TAG_BITS-1:0]      tags_read[0:ASSOCIATIVITY-1];
+wire [31:0]              readdata_cache[0:ASSOCIATIVITY-1];
+wire [ASSO_BITS-1:0]     next_way;
+
+//------------------------------------------------------------------------------
+
+// fifo for snoop, cleared while the cache is being invalidated
+wire [61:0] Fifo_dout;
+wire        Fifo_empty;
+wire        Fifo_full;
+wire        Fifo_rdreq = (state == IDLE) && !Fifo_empty;
+
+simple_fifo #(
+	.widthu(4),
+	.width(62)
+)
+isimple_fifo (
+	.clk(CLK),
+	.rst_n(1'b1),
+	.sclr(RESET || state == START),
+
+	.data({snoop_be, snoop_data, snoop_addr}),
+	.wrreq(snoop_we),
+
+	.q(Fifo_dout),
+	.rdreq(Fifo_rdreq),
+	.empty(Fifo_empty),
+	.full(Fifo_full)
+);
+
+// a snooped write did not fit, some cached dword may be stale
+reg snoop_overflow;
+
+always @(posedge CLK) begin
+	if (RESET || state == START)                  snoop_overflow <= 1'b0;
+	else if (snoop_we && Fifo_full && !Fifo_rdreq) snoop_overflow <= 1'b1;
+end
+
+//------------------------------------------------------------------------------
+
+`ifdef VERILATOR
+// Invalidate the whole cache after the simulation harness writes memory
+// directly, same as l1_icache.
+reg host_flush_req = 1'b0;
+reg host_flush_ack = 1'b0;
+
+export "DPI-C" task dcache_flush;
+task dcache_flush();
+	host_flush_req = ~host_flush_req;
+endtask
+
+wire host_flush = host_flush_req != host_flush_ack;
+`else
+wire host_flush = 1'b0;
+`endif
+
+//------------------------------------------------------------------------------
+
+reg                 hit;
+reg [ASSO_BITS-1:0] hit_way;
+reg                 has_free;
+reg [ASSO_BITS-1:0] free_way;
+
+always @* begin : lookup
+	integer i;
+	hit      = 1'b0;
+	hit_way  = {ASSO_BITS{1'b0}};
+	has_free = 1'b0;
+	free_way = {ASSO_BITS{1'b0}};
+	for (i = 0; i < ASSOCIATIVITY; i = i + 1) begin
+		if (tags_valid[i] && tags_read[i] == read_tag) begin
+			hit     = 1'b1;
+			hit_way = i[ASSO_BITS-1:0];
+		end
+		if (!tags_valid[i] && !has_free) begin
+			has_free = 1'b1;
+			free_way = i[ASSO_BITS-1:0];
+		end
+	end
+end
+
+wire [31:0] hit_data = readdata_cache[hit_way];
+
+wire snoop_rom = `ROM_SEGMENT(read_addr[27:16]);
+
+wire cacheable = !CPU_CACHE_DISABLE && CPU_ADDR[31:28] == 4'd0;
+wire cpu_start = state == IDLE && !host_flush && !snoop_overflow && Fifo_empty && !snoop_we && !CPU_WRITE_PENDING && CPU_REQ;
+
+//------------------------------------------------------------------------------
+
+assign MEM_READ_REQ    = (state == UNCACHED) || (cpu_start && !cacheable);
+assign MEM_READ_ADDR   = CPU_ADDR;
+assign MEM_READ_LENGTH = CPU_LENGTH;
+
+assign MEM_FILL_REQ    = state == FILL;
+assign MEM_FILL_ADDR   = {4'd0, read_addr[27:LINESIZE_BITS+2], {LINESIZE_BITS{1'b0}}, 2'b00};
+
+assign CPU_DONE = (state == READ_DONE) || (state == UNCACHED && MEM_READ_DONE);
+assign CPU_DATA = (state == UNCACHED) ? MEM_READ_DATA : read_buf[{byte_offset, 3'b000} +: 64];
+
+//------------------------------------------------------------------------------
+
+always @(posedge CLK) begin
+	if (RESET) begin
+		state     <= START;
+		start_set <= {LINE_BITS{1'b0}};
+	end
+	else begin
+		case (state)
+			START:
+			begin
+				start_set <= start_set + 1'd1;
+				if (start_set == {LINE_BITS{1'b1}}) state <= IDLE;
+			end
+
+			IDLE:
+			begin
+				if (host_flush || snoop_overflow) begin
+`ifdef VERILATOR
+					host_flush_ack <= host_flush_req;
+`endif
+					state     <= START;
+					start_set <= {LINE_BITS{1'b0}};
+				end
+				else if (!Fifo_empty) begin
+					state        <= SNOOP;
+					read_addr    <= Fifo_dout[25:0];
+					snoop_data_r <= Fifo_dout[57:26];
+					snoop_be_r   <= Fifo_dout[61:58];
+				end
+				else if (cpu_start) begin
+					state       <= cacheable ? LOOKUP : UNCACHED;
+					read_addr   <= CPU_ADDR[27:2];
+					byte_offset <= CPU_ADDR[1:0];
+					word_idx    <= 2'd0;
+					word_last   <= ({2'b00, CPU_ADDR[1:0]} + CPU_LENGTH - 4'd1) >> 2;
+				end
+			end
+
+			SNOOP:
+				state <= IDLE;
+
+			LOOKUP:
+			begin
+				if (hit) begin
+					read_buf[{word_idx, 5'b00000} +: 32] <= hit_data;
+					if (word_idx == word_last) state <= READ_DONE;
+					word_idx  <= word_idx + 1'd1;
+					read_addr <= read_addr + 1'd1;
+				end
+				else begin
+					state     <= FILL;
+					fillcount <= {LINESIZE_BITS{1'b0}};
+					victim    <= has_free ? free_way : next_way;
+				end
+			end
+
+			FILL:
+				if (MEM_FILL_VALID) begin
+					fillcount <= fillcount + 1'd1;
+					if (fillcount == {LINESIZE_BITS{1'b1}}) state <= LOOKUP;
+				end
+
+			READ_DONE:
+				state <= IDLE;
+
+			UNCACHED:
+				if (MEM_READ_DONE) state <= IDLE;
+
+			default : ;
+		endcase
+	end
+end
+
+//------------------------------------------------------------------------------
+
+wire fill_last = state == FILL && MEM_FILL_VALID && fillcount == {LINESIZE_BITS{1'b1}};
+
+wire [RAMSIZEBITS-1:0] ram_wraddr = (state == FILL) ? {read_set, fillcount} : read_addr[RAMSIZEBITS+1:2];
+
+wire [31:0] snoop_merged = {
+	snoop_be_r[3] ? snoop_data_r[31:24] : hit_data[31:24],
+	snoop_be_r[2] ? snoop_data_r[23:16] : hit_data[23:16],
+	snoop_be_r[1] ? snoop_data_r[15:8]  : hit_data[15:8],
+	snoop_be_r[0] ? snoop_data_r[7:0]   : hit_data[7:0]
+};
+
+wire [31:0] ram_wrdata = (state == FILL) ? MEM_FILL_DATA : snoop_merged;
+
+wire [ASSOCIATIVITY-1:0] victim_mask = 1 << victim;
+wire [ASSOCIATIVITY-1:0] valid_in = (state == START) ? {ASSOCIATIVITY{1'b0}} : tags_valid | victim_mask;
+wire [LINE_BITS-1:0]     valid_wraddr = (state == START) ? start_set : read_set;
+wire                     valid_we = state == START || fill_last;
+
+dpram_async #(
+	.width(ASSOCIATIVITY),
+	.widthad(LINE_BITS)
+)
+validram (
+	.clk(CLK),
+
+	.data(valid_in),
+	.rdaddress(read_set),
+	.wraddress(valid_wraddr),
+	.wren(valid_we),
+	.q(tags_valid)
+);
+
+// round-robin replacement once all ways of a set are valid
+dpram_async #(
+	.width(ASSO_BITS),
+	.widthad(LINE_BITS)
+)
+wayram (
+	.clk(CLK),
+
+	.data((state == START) ? {ASSO_BITS{1'b0}} : victim + 1'd1),
+	.rdaddress(read_set),
+	.wraddress(valid_wraddr),
+	.wren(valid_we),
+	.q(next_way)
+);
+
+generate
+	genvar i;
+	for (i = 0; i < ASSOCIATIVITY; i = i + 1) begin : gcache
+		dpram_async #(
+			.width(TAG_BITS),
+			.widthad(LINE_BITS)
+		)
+		tagram (
+			.clk(CLK),
+
+			.data(read_tag),
+			.rdaddress(read_set),
+			.wraddress(read_set),
+			.wren(fill_last && victim == i),
+			.q(tags_read[i])
+		);
+
+		dpram_async #(
+			.width(32),
+			.widthad(RAMSIZEBITS)
+		)
+		ram (
+			.clk(CLK),
+
+			.data(ram_wrdata),
+			.rdaddress(read_addr[RAMSIZEBITS+1:2]),
+			.wraddress(ram_wraddr),
+			.wren((state == FILL && MEM_FILL_VALID && victim == i) ||
+			      (state == SNOOP && hit && !snoop_rom && hit_way == i)),
+			.q(readdata_cache[i])
+		);
+	end
+endgenerate
+
+//------------------------------------------------------------------------------
+
+`ifdef VERILATOR
+// Counters for the simulation harness. A read is a cacheable CPU read
+// request, a miss is a line fill (one read can need two), uncached reads
+// bypass the cache, snoop hits are writes that updated a cached dword,
+// overflows are snoop fifo overflows that invalidated the cache.
+reg [63:0] stat_reads       /* verilator public */;
+reg [63:0] stat_misses      /* verilator public */;
+reg [63:0] stat_uncached    /* verilator public */;
+reg [63:0] stat_snoop_hits  /* verilator public */;
+reg [63:0] stat_overflows   /* verilator public */;
+
+always @(posedge CLK) begin
+	if (RESET) begin
+		stat_reads      <= 64'd0;
+		stat_misses     <= 64'd0;
+		stat_uncached   <= 64'd0;
+		stat_snoop_hits <= 64'd0;
+		stat_overflows  <= 64'd0;
+	end
+	else begin
+		if (cpu_start) begin
+			if (cacheable) stat_reads    <= stat_reads + 1'd1;
+			else           stat_uncached <= stat_uncached + 1'd1;
+		end
+		if (state == LOOKUP && !hit)                    stat_misses     <= stat_misses + 1'd1;
+		if (state == SNOOP && hit && !snoop_rom)        stat_snoop_hits <= stat_snoop_hits + 1'd1;
+		if (state == IDLE && snoop_overflow && !host_flush) stat_overflows <= stat_overflows + 1'd1;
+	end
+end
+`endif
+
+endmodule
@@ -105,6 +105,19 @@ assign CPU_DATA = readdata_cache[cache_mux];
 reg force_fetch;
 reg force_next;
 
+`ifdef VERILATOR
+// Invalidate the whole cache after the simulation harness writes memory
+// directly (these writes are not snooped). The request is a toggle so the
+// DPI task and the state machine never assign the same variable.
+reg host_flush_req = 1'b0;
+reg host_flush_ack = 1'b0;
+
+export "DPI-C" task icache_flush;
+task icache_flush();
+	host_flush_req = ~host_flush_req;
+endtask
+`endif
+
 always @(posedge CLK) begin : mainfsm
 	reg [ASSO_BITS:0]   i;
 	reg [ASSO_BITS-1:0] match;
@@ -159,6 +172,16 @@ always @(posedge CLK) begin : mainfsm
 		
 			IDLE:
 				begin
+`ifdef VERILATOR
+					if (host_flush_req != host_flush_ack) begin
+						host_flush_ack  <= host_flush_req;
+						state           <= START;
+						update_tag_addr <= {LINE_BITS{1'b0}};
+						update_tag_we   <= 1'b1;
+						tags_dirty_in   <= {ASSOCIATIVITY{1'b1}};
+					end
+					else
+`endif
 					if (!Fifo_empty) begin
 						state         <= WRITEONE;
 						read_addr     <= Fifo_dout[25:0];
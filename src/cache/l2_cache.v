@@ -1,3 +1,8 @@
+// L2 cache from the MiSTer ao486 core, with the Altera RAM primitives replaced
+// by the models in common/dpram.v. The original is in l2_cache_alt.v.
+// Write-through: writes update a cached line and always go to memory.
+// Writes to the ROM segments (rom_area.vh) are dropped, as in sdram_sim; the
+// original uma_ram=1 layout (D and E as RAM) is not used by this simulator.
 
 module l2_cache #(parameter ADDRBITS = 24)
 (
@@ -43,6 +48,7 @@ module l2_cache #(parameter ADDRBITS = 24)
 	input         uma_ram
 );
 
+`include "rom_area.vh"
 
 // cache settings
 localparam LINES         = 128;
@@ -135,6 +141,18 @@ reg         CPU_WE_1;
 reg         RESET_1;
 reg         RESET_2;
 
+`ifdef VERILATOR
+// Invalidate the whole cache after the simulation harness writes memory
+// directly, same as l1_icache.
+reg host_flush_req = 1'b0;
+reg host_flush_ack = 1'b0;
+
+export "DPI-C" task l2_flush;
+task l2_flush();
+	host_flush_req = ~host_flush_req;
+endtask
+`endif
+
 assign DDRAM_BURSTCNT = ram_burstcnt;
 assign DDRAM_ADDR     = ram_addr;
 assign DDRAM_RD       = ram_rd;
@@ -187,7 +205,7 @@ end
 
 wire ram_rgn = !CPU_ADDR[29:ADDRBITS+2];                                                       // = below 256MB
 wire rom_rgn = uma_ram ? (CPU_ADDR[ADDRBITS+1:14] == 'hC) || (CPU_ADDR[ADDRBITS+1:14] == 'hF)  // = 0xC0000-0xCFFFF (VGA-ROM), 0xD0000-0xEFFFF (UMA RAM), 0xF0000-0xFFFFF (BIOS-ROM)
-                       : (CPU_ADDR[ADDRBITS+1:16] == 'h3);                                     // = 0xC0000-0xFFFFF (VGA-ROM...BIOS-ROM) (UMA RAM disabled)
+                       : `ROM_SEGMENT(CPU_ADDR[ADDRBITS+1:14]);                                // = segments C, D and F, as in sdram_sim (rom_area.vh)
 wire vga_rgn = (CPU_ADDR[ADDRBITS+1:15] == 'h5)  && ((CPU_ADDR[14:13] & vga_mask) == vga_cmp); // = 0xA0000-0xBFFFF (VGA: exact region depends on VGA_MODE)
 wire shr_rgn = (CPU_ADDR[ADDRBITS+1:11] == 'h67) && shr_rgn_en;                                // = 0xCE000-0xCFFFF (used by shared folder)
 
@@ -257,6 +275,16 @@ always @(posedge CLK) begin
 				begin
 					vga_wr <= 1'b0;
 					vga_re <= 1'b0;
+`ifdef VERILATOR
+					if (host_flush_req != host_flush_ack) begin
+						host_flush_ack  <= host_flush_req;
+						state           <= START;
+						update_tag_addr <= {LINE_BITS{1'b0}};
+						update_tag_we   <= 1'b1;
+						tags_dirty_in   <= {ASSOCIATIVITY{1'b1}};
+					end
+					else
+`endif
 					if (!DDRAM_BUSY) begin
 						
 						// for timing purposes, most registers are assigned without region checks
@@ -473,31 +501,55 @@ always @(posedge CLK) begin
 	end
 end
 
-altdpram #(
-	.indata_aclr("OFF"),
-	.indata_reg("INCLOCK"),
-	.intended_device_family("Cyclone V"),
-	.lpm_type("altdpram"),
-	.outdata_aclr("OFF"),
-	.outdata_reg("UNREGISTERED"),
-	.ram_block_type("MLAB"),
-	.rdaddress_aclr("OFF"),
-	.rdaddress_reg("UNREGISTERED"),
-	.rdcontrol_aclr("OFF"),
-	.rdcontrol_reg("UNREGISTERED"),
-	.read_during_write_mode_mixed_ports("CONSTRAINED_DONT_CARE"),
+`ifdef VERILATOR
+// Counters for the simulation harness. A read request is a CPU read that
+// goes through the cache (not VGA). A miss is a line fill. Writes go to
+// memory either way, write hits also update the cached line.
+reg [63:0] stat_reads       /* verilator public */;
+reg [63:0] stat_misses      /* verilator public */;
+reg [63:0] stat_writes      /* verilator public */;
+reg [63:0] stat_write_hits  /* verilator public */;
+reg [63:0] stat_vga         /* verilator public */;
+
+wire [ASSOCIATIVITY-1:0] stat_way_hit;
+genvar s;
+generate
+	for (s = 0; s < ASSOCIATIVITY; s = s + 1) begin : gstat
+		assign stat_way_hit[s] = ~tags_dirty_out[s] && tags_read[s] == read_addr[ADDRBITS:RAMSIZEBITS];
+	end
+endgenerate
+
+wire stat_vga_access = ram_rgn & vga_rgn & ~VGA_FB_EN;
+
+always @(posedge CLK) begin
+	if (RESET) begin
+		stat_reads      <= 64'd0;
+		stat_misses     <= 64'd0;
+		stat_writes     <= 64'd0;
+		stat_write_hits <= 64'd0;
+		stat_vga        <= 64'd0;
+	end
+	else begin
+		if (state == IDLE && host_flush_req == host_flush_ack && !DDRAM_BUSY) begin
+			if (CPU_RD & ~stat_vga_access)                                      stat_reads <= stat_reads + 1'd1;
+			if ((CPU_RD | (CPU_WE & (~rom_rgn | shr_rgn))) & stat_vga_access)   stat_vga   <= stat_vga + 1'd1;
+		end
+		if (state == READONE && (force_next || stat_way_hit == 0))            stat_misses <= stat_misses + 1'd1;
+		if (state == WRITEONE) begin
+			stat_writes <= stat_writes + 1'd1;
+			if (stat_way_hit != 0) stat_write_hits <= stat_write_hits + 1'd1;
+		end
+	end
+end
+`endif
+
+dpram_async #(
 	.width(ASSOCIATIVITY),
-	.widthad(LINE_BITS),
-	.width_byteena(1),
-	.wraddress_aclr("OFF"),
-	.wraddress_reg("INCLOCK"),
-	.wrcontrol_aclr("OFF"),
-	.wrcontrol_reg("INCLOCK")
+	.widthad(LINE_BITS)
 )
 dirtyram (
-	.inclock(CLK),
-	.outclock(CLK),
-	
+	.clk(CLK),
+
 	.data(tags_dirty_in),
 	.rdaddress(read_addr[LINEMASKMSB:LINEMASKLSB]),
 	.wraddress(update_tag_addr),
@@ -508,31 +560,13 @@ dirtyram (
 generate
 	genvar i;
 	for (i = 0; i < ASSOCIATIVITY; i = i + 1) begin : gcache
-		altdpram #(
-			.indata_aclr("OFF"),
-			.indata_reg("INCLOCK"),
-			.intended_device_family("Cyclone V"),
-			.lpm_type("altdpram"),
-			.outdata_aclr("OFF"),
-			.outdata_reg("UNREGISTERED"),
-			.ram_block_type("MLAB"),
-			.rdaddress_aclr("OFF"),
-			.rdaddress_reg("UNREGISTERED"),
-			.rdcontrol_aclr("OFF"),
-			.rdcontrol_reg("UNREGISTERED"),
-			.read_during_write_mode_mixed_ports("CONSTRAINED_DONT_CARE"),
+		dpram_async #(
 			.width(ADDRBITS - RAMSIZEBITS + 1),
-			.widthad(LINE_BITS),
-			.width_byteena(1),
-			.wraddress_aclr("OFF"),
-			.wraddress_reg("INCLOCK"),
-			.wrcontrol_aclr("OFF"),
-			.wrcontrol_reg("INCLOCK")
+			.widthad(LINE_BITS)
 		)
 		tagram (
-			.inclock(CLK),
-			.outclock(CLK),
-			
+			.clk(CLK),
+
 			.data(read_addr[ADDRBITS:RAMSIZEBITS]),
 			.rdaddress(read_addr[LINEMASKMSB:LINEMASKLSB]),
 			.wraddress(read_addr[LINEMASKMSB:LINEMASKLSB]),
@@ -540,87 +574,33 @@ generate
 			.q(tags_read[i])
 		);
 
-		altdpram #(
-			.indata_aclr("OFF"),
-			.indata_reg("INCLOCK"),
-			.intended_device_family("Cyclone V"),
-			.lpm_type("altdpram"),
-			.outdata_aclr("OFF"),
-			.outdata_reg("UNREGISTERED"),
-			.ram_block_type("MLAB"),
-			.rdaddress_aclr("OFF"),
-			.rdaddress_reg("UNREGISTERED"),
-			.rdcontrol_aclr("OFF"),
-			.rdcontrol_reg("UNREGISTERED"),
-			.read_during_write_mode_mixed_ports("CONSTRAINED_DONT_CARE"),
+		dpram_async #(
 			.width(ASSO_BITS),
-			.widthad(LINE_BITS),
-			.width_byteena(1),
-			.wraddress_aclr("OFF"),
-			.wraddress_reg("INCLOCK"),
-			.wrcontrol_aclr("OFF"),
-			.wrcontrol_reg("INCLOCK")
+			.widthad(LINE_BITS)
 		)
 		LRUram (
-			.inclock(CLK),
-			.outclock(CLK),
-			
+			.clk(CLK),
+
 			.data(LRU_in[i]),
 			.rdaddress(LRU_addr),
 			.wraddress(LRU_addr),
 			.wren(LRU_we),
 			.q(LRU_out[i])
 		);
-		
-		altsyncram #(
-			.address_aclr_b("NONE"),
-			.address_reg_b("CLOCK0"),
-			.byte_size(8),
-			.clock_enable_input_a("BYPASS"),
-			.clock_enable_input_b("BYPASS"),
-			.clock_enable_output_b("BYPASS"),
-			.intended_device_family("Cyclone V"),
-			.lpm_type("altsyncram"),
-			.numwords_a(2**RAMSIZEBITS),
-			.numwords_b(2**(RAMSIZEBITS+1)),
-			.operation_mode("DUAL_PORT"),
-			.outdata_aclr_b("NONE"),
-			.outdata_reg_b("UNREGISTERED"),
-			.power_up_uninitialized("FALSE"),
-			.read_during_write_mode_mixed_ports("DONT_CARE"),
-			.widthad_a(RAMSIZEBITS),
-			.widthad_b(RAMSIZEBITS+1),
-			.width_a(64),
-			.width_b(32),
-			.width_byteena_a(8)
+
+		dpram_w64r32 #(
+			.ADRW(RAMSIZEBITS)
 		)
 		ram (
-			.clock0 (CLK),
+			.clock(CLK),
 
 			.address_a(memory_addr_b),
-			.byteena_a(memory_be),
+			.be_a(memory_be),
 			.data_a(memory_datain),
 			.wren_a(memory_we[i]),
 
 			.address_b({read_addr[RAMSIZEBITS - 1:0], data64_high}),
-			.q_b(readdata_cache[i]),
-
-			.aclr0(1'b0),
-			.aclr1(1'b0),
-			.addressstall_a(1'b0),
-			.addressstall_b(1'b0),
-			.byteena_b(1'b1),
-			.clock1(1'b1),
-			.clocken0(1'b1),
-			.clocken1(1'b1),
-			.clocken2(1'b1),
-			.clocken3(1'b1),
-			.data_b(32'b0),
-			.eccstatus(),
-			.q_a(),
-			.rden_a(1'b1),
-			.rden_b(1'b1),
-			.wren_b(1'b0)
+			.q_b(readdata_cache[i])
 		);
 	end
 endgenerate 
@@ -0,0 +1,70 @@
+// FIFO that moves up to WORDS entries per cycle on either side.
+//
+// Same count/flag semantics as simple_fifo ({full, usedw} is the fill level),
+// but wrreq stores the low `wrwords` entries of `data` and rdreq drops
+// `rdwords` entries. `q` always shows the WORDS entries from the head.
+// Used between ide.v and driver_sd so a sector moves in 128/WORDS cycles.
+module burst_fifo
+#(
+    parameter width     = 32,
+    parameter widthu    = 11,
+    parameter words     = 4
+)
+(
+    input                           clk,
+    input                           rst_n,
+    input                           sclr,
+
+    input                           wrreq,
+    input       [widthu:0]          wrwords,
+    input       [width*words-1:0]   data,
+
+    input                           rdreq,
+    input       [widthu:0]          rdwords,
+    output      [width*words-1:0]   q,
+
+    output                          empty,
+    output                          full,
+    output      [widthu-1:0]        usedw
+);
+
+reg [width-1:0] mem [(2**widthu)-1:0];
+
+reg [widthu-1:0] rd_index = 0;
+reg [widthu-1:0] wr_index = 0;
+reg [widthu:0]   count = 0;
+
+wire do_read  = rdreq && count >= rdwords;
+wire do_write = wrreq && count + wrwords - (do_read ? rdwords : 0) <= 2**widthu;
+
+assign empty = count == 0;
+assign full  = count[widthu];
+assign usedw = count[widthu-1:0];
+
+genvar g;
+generate
+    for (g = 0; g < words; g = g + 1) begin : head
+        wire [widthu-1:0] index = rd_index + g;
+        assign q[g*width +: width] = mem[index];
+    end
+endgenerate
+
+integer i;
+always @(posedge clk) begin
+    for (i = 0; i < words; i = i + 1)
+        if (do_write && i < wrwords) mem[wr_index + i[widthu-1:0]] <= data[i*width +: width];
+end
+
+always @(posedge clk) begin
+    if(rst_n == 1'b0 || sclr) begin
+        rd_index <= 0;
+        wr_index <= 0;
+        count    <= 0;
+    end else begin
+        if(do_read)  rd_index <= rd_index + rdwords[widthu-1:0];
+        if(do_write) wr_index <= wr_index + wrwords[widthu-1:0];
+        count <= count + (do_write ? wrwords : 0) - (do_read ? rdwords : 0);
+    end
+end
+
+endmodule
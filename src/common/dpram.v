@@ -102,6 +102,56 @@ module dpram_difclk
 
 endmodule
 
+// Dual-clock RAM with a 32-bit byte-enabled port A and an 8-bit read-only
+// port B onto the same bytes (little endian). Used for the VGA planes, so the
+// CPU side can move a dword per cycle while scanout reads bytes.
+module dpram_difclk_w32r8
+ #(  parameter ADRW = 8  // address width of the 32-bit port
+  )( input                 clk_a,
+     input                 clk_b,
+
+     input      [ADRW-1:0] address_a,
+     input      [3:0]      be_a,
+     input      [31:0]     data_a,
+     input                 wren_a,
+     input                 enable_a,
+     output reg [31:0]     q_a,
+
+     input      [ADRW+1:0] address_b,
+     input                 enable_b,
+     output     [7:0]      q_b
+  );
+
+    reg [31:0] mem [0:2**ADRW-1];
+    reg [31:0] word_b;
+    reg  [1:0] byte_b;
+    integer i;
+
+    // PORT A
+    always @(posedge clk_a)
+        if (wren_a)
+            for (i = 0; i < 4; i = i + 1)
+                if (be_a[i]) mem[address_a][i*8 +: 8] <= data_a[i*8 +: 8];
+
+    always @(posedge clk_a)
+        if (enable_a && !wren_a)
+            q_a <= mem[address_a];
+
+    // PORT B
+`ifdef VERILATOR
+    always @(posedge clk_a)
+`else
+    always @(posedge clk_b)
+`endif
+        if (enable_b) begin
+            word_b <= mem[address_b[ADRW+1:2]];
+            byte_b <= address_b[1:0];
+        end
+
+    assign q_b = word_b[byte_b*8 +: 8];
+
+endmodule
+
 // Dual-port RAM with byte enable
 module dpram_be
  #(  parameter ADRW = 8, // address width (therefore total size is 2**ADRW)
@@ -172,4 +222,33 @@ module dpram_async #(
     always @(posedge clk)
         if (wren)
             mem[wraddress] <= data;
-endmodule
\ No newline at end of file
+endmodule
+
+// RAM with a 64-bit byte-enabled write port and a 32-bit read port, with
+// registered read (altsyncram in DUAL_PORT mode as used by l2_cache)
+module dpram_w64r32 #(
+    parameter ADRW = 8      // address width of the 64-bit port
+) (
+    input                 clock,
+
+    input      [ADRW-1:0] address_a,
+    input      [7:0]      be_a,
+    input      [63:0]     data_a,
+    input                 wren_a,
+
+    input      [ADRW:0]   address_b,
+    output reg [31:0]     q_b
+);
+
+    reg [63:0] mem [0:2**ADRW-1];
+    integer i;
+
+    always @(posedge clock)
+        if (wren_a)
+            for (i = 0; i < 8; i = i + 1)
+                if (be_a[i]) mem[address_a][i*8 +: 8] <= data_a[i*8 +: 8];
+
+    always @(posedge clock)
+        q_b <= address_b[0] ? mem[address_b[ADRW:1]][63:32] : mem[address_b[ADRW:1]][31:0];
+
+endmodule
@@ -0,0 +1,16 @@
+// Write protected ROM area of the first megabyte, shared by every memory
+// backend (sdram_sim, l2_cache) and by l1_dcache's write snooping, so that
+// all builds agree on which writes are dropped.
+// Include inside a module body.
+//
+// Segments C (VGA BIOS), D (option ROMs) and F (system BIOS) are ROM once
+// the CPU runs; E stays ordinary RAM.
+//
+// `ROM_SEGMENT(addr[31:16]) with the 64KB segment number of a byte address.
+
+`ifndef ROM_AREA_VH
+`define ROM_AREA_VH
+
+`define ROM_SEGMENT(seg) ((seg) == 'hC || (seg) == 'hD || (seg) == 'hF)
+
+`endif
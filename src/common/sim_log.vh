@@ -0,0 +1,41 @@
+// Simulator log messages from RTL, through DPI to verilator/log.cpp.
+// Include inside a module body. Categories and levels match log.h.
+// Define SIM_LOG_OFF to compile all messages out.
+//
+// `SIM_LOG(`CAT_DISK, `LVL_DEBUG, $sformatf("sector %d", sector));
+// The message is only formatted when the category is enabled.
+
+`ifndef SIM_LOG_VH
+`define SIM_LOG_VH
+
+`define CAT_SIM   0
+`define CAT_IDE   1
+`define CAT_VGA   2
+`define CAT_KBD   3
+`define CAT_BIOS  4
+`define CAT_DISK  5
+`define CAT_FRAME 6
+
+`define LVL_ERROR 0
+`define LVL_WARN  1
+`define LVL_INFO  2
+`define LVL_DEBUG 3
+
+`ifdef VERILATOR
+`ifndef SIM_LOG_OFF
+`define SIM_LOG_ON
+`endif
+`endif
+
+`ifdef SIM_LOG_ON
+`define SIM_LOG(cat, lvl, msg) if (sim_log_enabled(cat, lvl) != 0) sim_log(cat, lvl, msg)
+`else
+`define SIM_LOG(cat, lvl, msg)
+`endif
+
+`endif
+
+`ifdef SIM_LOG_ON
+import "DPI-C" function int sim_log_enabled(input int category, input int level);
+import "DPI-C" function void sim_log(input int category, input int level, input string msg);
+`endif
@@ -1,5 +1,18 @@
 // SDRAM simulation that supports burst read, and VGA memory access
 // nand2mario, 7/2025
+//
+// With L2_CACHE defined, memory is accessed by l2_cache through the 64-bit
+// ddr_* port instead, with configurable latencies (in clk cycles):
+//   SDRAM_CAS_LATENCY    read command to first data beat (>= 1)
+//   SDRAM_BURST_GAP      idle cycles between the beats of a burst
+//   SDRAM_WRITE_LATENCY  busy cycles after a write
+// The 32-bit port then only takes the harness' debug writes.
+//
+// VGA accesses move all enabled bytes of a dword in one transaction: a write
+// takes a cycle and does not stall, a read returns after three.
+//
+// The RAM itself is in the harness (verilator/ram.cpp), accessed through
+// DPI. Its size is set at run time and pages are allocated on first write.
 module sdram_sim (
     input             clk,
     input             reset,
@@ -13,34 +26,57 @@ module sdram_sim (
     input             cpu_rd,
     input             cpu_we,
 
-    input             protect_rom,       // make 0xC0000 - 0xFFFFF write protected
+    input             protect_rom,       // make the ROM segments write protected, see rom_area.vh
 
-    output reg [16:0] vga_address,
-    input      [7:0]  vga_readdata,
-    output reg [7:0]  vga_writedata,
+    output reg [16:2] vga_address,       // dword address
+    output reg [3:0]  vga_byteenable,
+    input      [31:0] vga_readdata,
+    output reg [31:0] vga_writedata,
     input      [2:0]  vga_memmode,
     output reg        vga_read,
     output reg        vga_write,
 
     input      [5:0]  vga_wr_seg,
     input      [5:0]  vga_rd_seg,
-    input             vga_fb_en
+    input             vga_fb_en,
+
+    input      [24:0] ddr_addr,          // 64-bit word address
+    input      [63:0] ddr_din,
+    output reg [63:0] ddr_dout,
+    output reg        ddr_dout_ready,
+    input      [7:0]  ddr_be,
+    input      [7:0]  ddr_burstcount,
+    output            ddr_busy,
+    input             ddr_rd,
+    input             ddr_we
 );
 
-localparam SIZE_MB = 4;
-wire cpu_addr_region = cpu_addr < (SIZE_MB << 20);
+`ifndef SDRAM_CAS_LATENCY
+`define SDRAM_CAS_LATENCY 3
+`endif
+`ifndef SDRAM_BURST_GAP
+`define SDRAM_BURST_GAP 0
+`endif
+`ifndef SDRAM_WRITE_LATENCY
+`define SDRAM_WRITE_LATENCY 1
+`endif
+
+// byte address of a dword, reads outside of RAM return 0
+import "DPI-C" function int unsigned ram_read(input int unsigned addr);
+import "DPI-C" function void ram_write(input int unsigned addr, input int unsigned data, input byte unsigned be);
+import "DPI-C" function int unsigned ram_size();
 
-// 2MB of main memory
-localparam DWORD_CNT = SIZE_MB*1024*1024/4;
+// RAM size in bytes, fixed for the run (--ram)
+logic [31:0] ram_bytes;
+initial ram_bytes = ram_size();
 
-logic [31:0] mem [0:DWORD_CNT-1] /* verilator public */;
+wire cpu_addr_region = cpu_addr < ram_bytes;
 
 logic [2:0] state; 
 localparam IDLE = 0;
 localparam READ_BURST = 1;
 localparam VGA_READ_WAIT = 2;
 localparam VGA_READ = 3;
-localparam VGA_WRITE = 4;
 
 assign cpu_busy = (state != IDLE);
 
@@ -49,67 +85,36 @@ logic [31:2] burst_addr;
 
 reg   [1:0] vga_mask;
 reg   [1:0] vga_cmp;
-reg   [3:0] vga_be;
-reg   [2:0] vga_bcnt;
-reg   [1:0] vga_bank, vga_bank_t;
-reg   [31:0] vga_data;
-// reg   [1:0] boff_t, boff;
 
 // = 0xA0000-0xBFFFF (VGA: exact region depends on VGA_MODE)
 wire vga_rgn = (cpu_addr[31:17] == 'h5) && ((cpu_addr[16:15] & vga_mask) == vga_cmp); 
 
+`ifndef L2_CACHE
+
+assign ddr_busy = 1'b0;
+
 always @(posedge clk) begin
     if (reset) begin
         state <= IDLE;
         burst_left <= 0;
-`ifdef VERILATOR
-        for (int i = 0; i < DWORD_CNT; i++) begin
-            mem[i] = {4{8'hF4}};     // HLT
-        end
-`endif
     end else begin
         cpu_dout_ready <= 0;
         vga_read <= 0;
         vga_write <= 0;
         case (state)
             IDLE: begin
-                // set up vga access to point to 1st enabled byte
-                vga_address[16:2] <= cpu_addr[16:2];
-                if (cpu_be[0]) begin
-                    vga_be <= cpu_be;
-                    vga_bcnt <= 4;
-                    vga_bank_t = 0;
-                    vga_data <= cpu_din;
-                end else if (cpu_be[1]) begin
-                    vga_be <= cpu_be[3:1];
-                    vga_bcnt <= 3;
-                    vga_bank_t = 1;
-                    vga_data <= cpu_din[31:8];
-                end else if (cpu_be[2]) begin
-                    vga_be <= cpu_be[3:2];
-                    vga_bcnt <= 2;
-                    vga_bank_t = 2;
-                    vga_data <= cpu_din[31:16];
-                end else begin
-                    vga_be <= cpu_be[3:3];
-                    vga_bcnt <= 1;
-                    vga_bank_t = 3;
-                    vga_data <= cpu_din[31:24];
-                end
-                vga_bank <= vga_bank_t;
+                vga_address <= cpu_addr[16:2];
+                vga_byteenable <= cpu_be;
+                vga_writedata <= cpu_din;
 
                 if (cpu_rd) begin
                     if (vga_rgn) begin
-                        // VGA read, byte or word only
+                        // VGA read, all enabled bytes at once
                         state <= VGA_READ_WAIT;
                         vga_read <= 1;
-                        vga_address <= {cpu_addr[16:2], vga_bank_t};
                     end else begin
                         // Main memory read, supports burst
-                        if (!cpu_addr_region)
-                            cpu_dout <= 0;
-                        else
-                            cpu_dout <= mem[cpu_addr[31:2]];
+                        cpu_dout <= ram_read({cpu_addr[31:2], 2'b00});
                         cpu_dout_ready <= 1;
                         if (cpu_burstcount > 1) begin
                             state <= READ_BURST;
@@ -119,16 +124,12 @@ always @(posedge clk) begin
                     end
                 end else if (cpu_we) begin
                     if (vga_rgn) begin
-                        // VGA write
-                        state <= VGA_WRITE;
-                        // $display("VGA write: [%h]=%h, byteenable=%b", cpu_addr, cpu_din, cpu_be); 
+                        // VGA write, done by vga.v next cycle
+                        vga_write <= 1;
                     end else begin
                         if ((!protect_rom || !is_rom_area(cpu_addr)) && cpu_addr_region) begin
-                            // Main memory write, supports burst
-                            if (cpu_be[0]) mem[cpu_addr[31:2]][7:0] <= cpu_din[7:0];
-                            if (cpu_be[1]) mem[cpu_addr[31:2]][15:8] <= cpu_din[15:8];
-                            if (cpu_be[2]) mem[cpu_addr[31:2]][23:16] <= cpu_din[23:16];
-                            if (cpu_be[3]) mem[cpu_addr[31:2]][31:24] <= cpu_din[31:24];
+                            // Main memory write
+                            ram_write({cpu_addr[31:2], 2'b00}, cpu_din, {4'd0, cpu_be});
                         end
                     end
                 end
@@ -137,47 +138,84 @@ always @(posedge clk) begin
                 if (burst_left == 0) begin
                     state <= IDLE;
                 end else begin
-                    if (!cpu_addr_region)
-                        cpu_dout <= 0;
-                    else
-                        cpu_dout <= mem[burst_addr];
+                    cpu_dout <= ram_read({burst_addr, 2'b00});
                     cpu_dout_ready <= 1;
                     burst_addr <= burst_addr + 1;
                     burst_left <= burst_left - 1;
                 end
             end
-            VGA_READ_WAIT: begin   // vga_read == 1
+            VGA_READ_WAIT:         // vga_read == 1, plane RAMs read
                 state <= VGA_READ;
-                vga_be <= vga_be[3:1];
-                vga_bcnt <= vga_bcnt - 1;
-                vga_bank <= vga_bank + 1;
-            end
             VGA_READ: begin
-                vga_read <= vga_be[0];
-                vga_address[1:0] <= vga_bank;
-                cpu_dout <= {vga_readdata, cpu_dout[31:8]};
-                if (vga_bcnt == 0) begin
-                    cpu_dout_ready <= 1;
-                    state <= IDLE;
-                end else
-                    state <= VGA_READ_WAIT;
+                cpu_dout <= vga_readdata;
+                cpu_dout_ready <= 1;
+                state <= IDLE;
             end
-            VGA_WRITE: begin
-                vga_write <= vga_be[0];
-                vga_be <= vga_be[3:1];
-                vga_address[1:0] <= vga_bank;
-                vga_bank <= vga_bank + 1;
-                vga_writedata <= vga_data[7:0];
-                vga_data <= {8'h00, vga_data[31:8]};
-                if (!vga_be[3:1]) begin
-                    state <= IDLE;
+            default: ;
+        endcase
+    end
+end
+
+`else
+
+logic [1:0]  ddr_state;
+localparam DDR_IDLE  = 0;
+localparam DDR_READ  = 1;
+localparam DDR_WRITE = 2;
+
+logic [7:0]  ddr_wait;
+logic [7:0]  ddr_left;
+logic [24:0] ddr_ptr;
+
+assign ddr_busy = (ddr_state != DDR_IDLE);
+
+always @(posedge clk) begin
+    if (reset) begin
+        ddr_state <= DDR_IDLE;
+        ddr_dout_ready <= 0;
+    end else begin
+        ddr_dout_ready <= 0;
+
+        // debug writes from the harness
+        if (cpu_we && (!protect_rom || !is_rom_area(cpu_addr)) && cpu_addr_region)
+            ram_write({cpu_addr[31:2], 2'b00}, cpu_din, {4'd0, cpu_be});
+
+        case (ddr_state)
+            DDR_IDLE:
+                if (ddr_rd) begin
+                    ddr_ptr <= ddr_addr;
+                    ddr_left <= (ddr_burstcount == 0) ? 8'd1 : ddr_burstcount;
+                    ddr_wait <= `SDRAM_CAS_LATENCY - 1;
+                    ddr_state <= DDR_READ;
+                end else if (ddr_we) begin
+                    if (!protect_rom || !is_rom_area({4'd0, ddr_addr, 3'b000})) begin
+                        ram_write({ddr_addr, 3'b000}, ddr_din[31:0],  {4'd0, ddr_be[3:0]});
+                        ram_write({ddr_addr, 3'b100}, ddr_din[63:32], {4'd0, ddr_be[7:4]});
+                    end
+                    ddr_wait <= `SDRAM_WRITE_LATENCY - 1;
+                    if (`SDRAM_WRITE_LATENCY > 0) ddr_state <= DDR_WRITE;
                 end
-            end
+            DDR_READ:
+                if (ddr_wait != 0) begin
+                    ddr_wait <= ddr_wait - 1;
+                end else begin
+                    ddr_dout <= {ram_read({ddr_ptr, 3'b100}), ram_read({ddr_ptr, 3'b000})};
+                    ddr_dout_ready <= 1;
+                    ddr_ptr <= ddr_ptr + 1;
+                    ddr_left <= ddr_left - 1;
+                    ddr_wait <= `SDRAM_BURST_GAP;
+                    if (ddr_left == 1) ddr_state <= DDR_IDLE;
+                end
+            DDR_WRITE:
+                if (ddr_wait != 0) ddr_wait <= ddr_wait - 1;
+                else ddr_state <= DDR_IDLE;
             default: ;
         endcase
     end
 end
 
+`endif
+
 always @(posedge clk) begin
 	case (vga_memmode)
 		3'b100:		// 128K
@@ -212,8 +250,10 @@ always @(posedge clk) begin
 	endcase
 end
 
+`include "rom_area.vh"
+
 function automatic logic is_rom_area(input [31:0] addr);
-    return (addr[31:16] == 16'h000F || addr[31:16] == 16'h000C || addr[31:16] == 16'h000D);
+    return `ROM_SEGMENT(addr[31:16]);
 endfunction
 
 endmodule
\ No newline at end of file
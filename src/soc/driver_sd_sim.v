@@ -1,6 +1,8 @@
 // SD card module for ao486 simulation.
 // nand2mario, 7/2024
-module driver_sd (
+module driver_sd #(
+    parameter DWORDS = 1            // dwords per avm beat, matches ide's SD_DWORDS
+) (
     input               clk,
     input               rst_n,
     
@@ -15,10 +17,10 @@ module driver_sd (
     output      [31:0]  avm_address,
     input               avm_waitrequest,
     output              avm_read,
-    input       [31:0]  avm_readdata,
+    input       [32*DWORDS-1:0] avm_readdata,
     input               avm_readdatavalid,
     output              avm_write,
-    output      [31:0]  avm_writedata,
+    output      [32*DWORDS-1:0] avm_writedata,
     
     //
     output reg          sd_clk,
@@ -26,6 +28,8 @@ module driver_sd (
     inout       [3:0]   sd_dat
 );
 
+`include "sim_log.vh"
+
 reg [2:0] state;
 localparam IDLE = 0;
 localparam READ = 1;
@@ -34,20 +38,20 @@ localparam WRITE = 2;
 reg [23:0] sd_sector;
 reg [7:0] sd_sector_count;
 
-byte sd_buf[32*1024*1024] /* verilator public */;
-int unsigned sd_size;
-
-export "DPI-C" task sd_write;
-task sd_write(
-    input  int unsigned        addr,
-    input  byte unsigned       data
-);
-    sd_buf[addr] = data;
-endtask
+// the disk image lives in the harness (verilator/disk.cpp), which marks the
+// sectors written so the timeline only has to save those
+import "DPI-C" function int unsigned disk_read_dword(input int unsigned addr);
+import "DPI-C" function void disk_write_dword(input int unsigned addr, input int unsigned data);
 
-// initial $readmemh("dos6.vhd.hex", sd_buf);
+// --vdisk: sectors come from vdisk.cpp instead
+import "DPI-C" function int vdisk_enabled();
+import "DPI-C" function int unsigned vdisk_read_dword(input int unsigned addr);
+import "DPI-C" function void vdisk_write_dword(input int unsigned addr, input int unsigned data);
+bit vdisk;
+initial vdisk = vdisk_enabled() != 0;
 
 reg [29:0] sd_buf_ptr, sd_buf_ptr_end;
+integer i;
 
 always @(posedge clk) begin
     if (!rst_n) begin
@@ -82,23 +86,20 @@ always @(posedge clk) begin
             end
             READ: begin
                 avm_write <= 1;
-                avm_writedata[7:0] <= sd_buf[sd_buf_ptr];
-                avm_writedata[15:8] <= sd_buf[sd_buf_ptr+1];
-                avm_writedata[23:16] <= sd_buf[sd_buf_ptr+2];
-                avm_writedata[31:24] <= sd_buf[sd_buf_ptr+3];
-                sd_buf_ptr <= sd_buf_ptr + 4;     // todo: check avm_waitrequest
-                if (sd_buf_ptr + 4 == sd_buf_ptr_end) begin
+                for (i = 0; i < DWORDS; i = i + 1)
+                    avm_writedata[i*32 +: 32] <= vdisk ? vdisk_read_dword(sd_buf_ptr+i*4) : disk_read_dword(sd_buf_ptr+i*4);
+                sd_buf_ptr <= sd_buf_ptr + 4*DWORDS;     // todo: check avm_waitrequest
+                if (sd_buf_ptr + 4*DWORDS == sd_buf_ptr_end) begin
                     state <= IDLE;
                 end
             end
             WRITE: if (avm_readdatavalid) begin  // drive hdd-to-sd streaming with avm_read
-                $display("WRITE: sd[%x]=%x", sd_buf_ptr, avm_readdata);
-                sd_buf[sd_buf_ptr] <= avm_readdata[7:0];
-                sd_buf[sd_buf_ptr+1] <= avm_readdata[15:8];
-                sd_buf[sd_buf_ptr+2] <= avm_readdata[23:16];
-                sd_buf[sd_buf_ptr+3] <= avm_readdata[31:24];
-                sd_buf_ptr <= sd_buf_ptr + 4;
-                if (sd_buf_ptr + 4 == sd_buf_ptr_end)
+                `SIM_LOG(`CAT_DISK, `LVL_DEBUG, $sformatf("WRITE: sd[%x]=%x", sd_buf_ptr, avm_readdata));
+                for (i = 0; i < DWORDS; i = i + 1)
+                    if (vdisk) vdisk_write_dword(sd_buf_ptr+i*4, avm_readdata[i*32 +: 32]);
+                    else disk_write_dword(sd_buf_ptr+i*4, avm_readdata[i*32 +: 32]);
+                sd_buf_ptr <= sd_buf_ptr + 4*DWORDS;
+                if (sd_buf_ptr + 4*DWORDS == sd_buf_ptr_end)
                     state <= IDLE;
                 else
                     avm_read <= 1;
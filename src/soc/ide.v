@@ -28,7 +28,9 @@
 // Implements an ATA-3 controller using SD card storage as the backing medium.
 // Supports only 28-bit LBA addressing (up to 128GB); 48-bit LBA is not implemented.
 
-module ide (
+module ide #(
+    parameter SD_DWORDS = 1         // dwords per beat on the sd_slave data port, 1 to 128
+) (
     input               clk,
     input               rst_n,
     
@@ -62,9 +64,9 @@ module ide (
     //slave with data from/to sd
     input       [8:0]   sd_slave_address,
     input               sd_slave_read,
-    output reg  [31:0]  sd_slave_readdata,
+    output reg  [32*SD_DWORDS-1:0] sd_slave_readdata,
     input               sd_slave_write,
-    input       [31:0]  sd_slave_writedata,
+    input       [32*SD_DWORDS-1:0] sd_slave_writedata,
     
     //management slave
     /*
@@ -81,6 +83,8 @@ module ide (
     input       [31:0]  mgmt_writedata
 );
 
+`include "sim_log.vh"
+
 /*
 0x1F3	Sector‑Number	S(1–63)
 0x1F4	Cylinder‑Low	C<7:0>
@@ -95,6 +99,9 @@ reg present;
 
 `define SD_AVALON_BASE_ADDRESS_FOR_HDD 32'h00000000
 
+//if changed - fix cmd_multiple_abort_at_start
+`define MAX_MULTIPLE_SECTORS 16
+
 //------------------------------------------------------------------------------
 
 reg io_read_last;
@@ -162,7 +169,7 @@ always @(posedge clk or negedge rst_n) begin
     if(rst_n == 1'b0)                           media_cylinders <= 17'd0;
     else if(mgmt_address == 3'd1 && mgmt_write) begin 
         media_cylinders <= mgmt_writedata[16:0];
-        $display("IDE: media_cylinders: %d", mgmt_writedata[16:0]);
+        `SIM_LOG(`CAT_IDE, `LVL_INFO, $sformatf("media_cylinders: %0d", mgmt_writedata[16:0]));
         present <= mgmt_writedata[16:0] != 0;               // nand2mario: set present flag
     end
 end
@@ -365,11 +372,28 @@ always @(posedge clk or negedge rst_n) begin
     else if(io_write && io_address == 6) lba_mode <= io_writedata[6];
 end
 
+// Identify word 59 written through mgmt gives the power-on multiple setting,
+// so READ/WRITE MULTIPLE work without a SET MULTIPLE first.
+reg [6:0] mgmt_identify_index = 7'd0;
+always @(posedge clk) begin
+    if(mgmt_write && mgmt_address == 3'd0) mgmt_identify_index <= mgmt_identify_index + 7'd1;
+end
+
+wire       mgmt_multiple_write = mgmt_write && mgmt_address == 3'd0 && mgmt_identify_index == 7'd29;
+wire [4:0] mgmt_multiple       = (mgmt_writedata[24] && mgmt_writedata[23:16] <= `MAX_MULTIPLE_SECTORS)? mgmt_writedata[20:16] : 5'd0;
+
+reg [4:0] multiple_default;
+always @(posedge clk or negedge rst_n) begin
+    if(rst_n == 1'b0)               multiple_default <= 5'd0;
+    else if(mgmt_multiple_write)    multiple_default <= mgmt_multiple;
+end
+
 reg [4:0] multiple_sectors;
 always @(posedge clk or negedge rst_n) begin
-    if(rst_n == 1'b0)           multiple_sectors <= 5'd0;
-    else if(sw_reset_start)     multiple_sectors <= 5'd0;
-    else if(cmd_multiple_start) multiple_sectors <= sector_count[4:0];
+    if(rst_n == 1'b0)               multiple_sectors <= 5'd0;
+    else if(sw_reset_start)         multiple_sectors <= multiple_default;
+    else if(cmd_multiple_start)     multiple_sectors <= sector_count[4:0];
+    else if(mgmt_multiple_write)    multiple_sectors <= mgmt_multiple;
 end
 
 //------------------------------------------------------------------------------
@@ -463,8 +487,8 @@ wire update_location_to_overflow =
 wire update_location_to_max = cmd_max_start;
 
 wire update_location_by_one =
-    (state == S_SD_READ_WAIT_FOR_DATA && sd_slave_write && sd_counter == 7'd127) ||
-    (state == S_SD_WRITE_WAIT_FOR_DATA && sd_slave_read_valid && sd_counter == 7'd127); 
+    (state == S_SD_READ_WAIT_FOR_DATA && sd_slave_write && sd_counter == SD_LAST_DWORD) ||
+    (state == S_SD_WRITE_WAIT_FOR_DATA && sd_slave_read_valid && sd_counter == SD_LAST_DWORD); 
 
 wire update_location_chs_sector_only = update_location_by_one && ~(lba_mode) &&
     { 1'b0, sector } < media_spt;
@@ -551,8 +575,6 @@ wire cmd_verify_start = cmd_start && (io_writedata[7:0] == 8'h40 || io_writedata
 
 //set multiple
 
-//if changed - fix cmd_multiple_abort_at_start
-`define MAX_MULTIPLE_SECTORS 16
 
 wire cmd_multiple_prepare = cmd_start && io_writedata[7:0] == 8'hC6;
 
@@ -754,8 +776,8 @@ always @(posedge clk or negedge rst_n) begin
     else if(state == S_SD_AVALON_BASE && current_command_write_multiple)                                                        logical_sector_count <= multiple_final_write;
     else if(state == S_SD_AVALON_BASE)                                                                                          logical_sector_count <= 5'd1;
     
-    else if(state == S_SD_READ_WAIT_FOR_DATA  && sd_slave_write       && sd_counter == 7'd127 && logical_sector_count > 5'd0)   logical_sector_count <= logical_sector_count - 5'd1;
-    else if(state == S_SD_WRITE_WAIT_FOR_DATA && sd_slave_read_valid  && sd_counter == 7'd127 && logical_sector_count > 5'd0)   logical_sector_count <= logical_sector_count - 5'd1;
+    else if(state == S_SD_READ_WAIT_FOR_DATA  && sd_slave_write       && sd_counter == SD_LAST_DWORD && logical_sector_count > 5'd0)   logical_sector_count <= logical_sector_count - 5'd1;
+    else if(state == S_SD_WRITE_WAIT_FOR_DATA && sd_slave_read_valid  && sd_counter == SD_LAST_DWORD && logical_sector_count > 5'd0)   logical_sector_count <= logical_sector_count - 5'd1;
 end
 
 wire count_decision_immediate_error =
@@ -817,11 +839,15 @@ end
     
 //------------------------------------------------------------------------------ sd
 
+// dword index of the current beat within the sector
+localparam [6:0] SD_BEAT_DWORDS = SD_DWORDS;
+localparam [6:0] SD_LAST_DWORD  = 128 - SD_DWORDS;
+
 reg [6:0] sd_counter;
 always @(posedge clk or negedge rst_n) begin
     if(rst_n == 1'b0)	                                                            sd_counter <= 7'd0;
     else if(state != S_SD_READ_WAIT_FOR_DATA && state != S_SD_WRITE_WAIT_FOR_DATA)  sd_counter <= 7'd0;
-    else if(sd_slave_write || sd_slave_read_valid)                                  sd_counter <= sd_counter + 7'd1;
+    else if(sd_slave_write || sd_slave_read_valid)                                  sd_counter <= sd_counter + SD_BEAT_DWORDS;
 end
 
 reg [31:0] sd_sector;
@@ -931,10 +957,14 @@ wire from_hdd_empty_valid = from_hdd_empty && from_hdd_stored_index == 2'd0;
 
 wire        from_hdd_empty;
 wire [31:0] from_hdd_q;
+wire [32*SD_DWORDS-1:0] from_hdd_head;
+assign from_hdd_q = from_hdd_head[31:0];
 
-simple_fifo #(
+// sectors arrive SD_DWORDS at a time, the identify block one dword at a time
+burst_fifo #(
     .width      (32),
-    .widthu     (11)
+    .widthu     (11),
+    .words      (SD_DWORDS)
 )
 fifo_from_hdd_inst(
     .clk        (clk),
@@ -942,12 +972,14 @@ fifo_from_hdd_inst(
     
     .sclr       (sw_reset_start),                                                                   //input
     
-    .data       ((state == S_IDENTIFY_FILL)? identify_q_final : sd_slave_writedata),                //input [31:0]
+    .data       ((state == S_IDENTIFY_FILL)? identify_q_final : sd_slave_writedata),                //input
     .wrreq      ((state == S_SD_READ_WAIT_FOR_DATA && sd_slave_write) || state == S_IDENTIFY_FILL), //input
+    .wrwords    ((state == S_IDENTIFY_FILL)? 12'd1 : SD_DWORDS),                                    //input [11:0]
     
     .rdreq      (read_data_io && { 1'b0, from_hdd_stored_index } < data_io_size),                   //input
+    .rdwords    (12'd1),                                                                            //input [11:0]
     .empty      (from_hdd_empty),                                                                   //output
-    .q          (from_hdd_q),                                                                       //output [31:0]
+    .q          (from_hdd_head),                                                                    //output
 
     /* verilator lint_off PINNOCONNECT */
     .full       (),                                                                                 //output
@@ -984,18 +1016,20 @@ always @(posedge clk or negedge rst_n) begin
 end
 
 always @(posedge clk or negedge rst_n) begin
-    if(rst_n == 1'b0)   sd_slave_readdata <= 32'b0;
+    if(rst_n == 1'b0)   sd_slave_readdata <= 0;
     else                sd_slave_readdata <= to_hdd_q;
 end
 
 wire [11:0] to_hdd_count = { to_hdd_full, to_hdd_usedw };
 wire [10:0] to_hdd_usedw;
 wire        to_hdd_full;
-wire [31:0] to_hdd_q;
+wire [32*SD_DWORDS-1:0] to_hdd_q;
 
-simple_fifo #(
+// filled by the CPU one dword at a time, drained SD_DWORDS at a time
+burst_fifo #(
     .width      (32),
-    .widthu     (11)
+    .widthu     (11),
+    .words      (SD_DWORDS)
 )
 fifo_to_hdd_inst(
     .clk        (clk),
@@ -1003,12 +1037,14 @@ fifo_to_hdd_inst(
     
     .sclr       (sw_reset_start),                                               //input
     
-    .data       (to_hdd_result[31:0]),                                          //input [31:0]
+    .data       (to_hdd_result[31:0]),                                          //input
     .wrreq      (write_data_io && to_hdd_sum >= 3'd4 && ~(write_data_ready)),   //input
+    .wrwords    (12'd1),                                                        //input [11:0]
     .full       (to_hdd_full),                                                  //output
     
     .rdreq      (state == S_SD_WRITE_WAIT_FOR_DATA && sd_slave_read_valid),     //input
-    .q          (to_hdd_q),                                                     //output [31:0]
+    .rdwords    (SD_DWORDS),                                                    //input [11:0]
+    .q          (to_hdd_q),                                                     //output
 
     .usedw      (to_hdd_usedw),                                                 //output [10:0]
     
@@ -97,6 +97,11 @@ i8259 pic_sla
 
 assign interrupt_vector = sla_select ? sla_vector : mas_vector;
 
+`ifdef VERILATOR
+// IRQ line (0-15) behind interrupt_vector, for the harness (irqstat.cpp)
+wire [3:0] interrupt_line /* verilator public */ = sla_select ? { 1'b1, sla_vector[2:0] } : { 1'b0, mas_vector[2:0] };
+`endif
+
 always @(posedge clk) begin
 	if(io_master_cs) io_readdata <= mas_readdata;
 	else             io_readdata <= sla_readdata;
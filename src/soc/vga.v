@@ -40,11 +40,12 @@ module vga
 	input               io_d_cs,
 
 	//avalon slave vga memory
-	input      [16:0]   mem_address,
+	input      [16:2]   mem_address,     // dword address
+	input       [3:0]   mem_byteenable,
 	input               mem_read,
-	output      [7:0]   mem_readdata,
+	output     [31:0]   mem_readdata,
 	input               mem_write,
-	input       [7:0]   mem_writedata,
+	input      [31:0]   mem_writedata,
 
 	//interrupt (IRQ2)
 	output              irq,
@@ -798,36 +799,45 @@ wire [7:0] host_io_read_wire =
 
 //------------------------------------------------------------------------------
 
+// The host port moves up to four bytes per cycle. mem_address is a dword
+// address, and byte i of the dword does what a byte access to
+// mem_address*4+i would. Planes are stored as dwords, and the byte's offset
+// within the plane picks the lane:
+//   chain 4     byte i is plane i, lane 0
+//   odd/even    byte i is planes i[0] and i[0]+2, lane {i[1],0}
+//   planar      byte i is every plane, lane i
+// No two bytes of a dword share a plane lane, so all of them go at once.
+wire [16:0] host_mem_address = { mem_address, 2'b00 };
+
 wire host_memory_out_of_bounds =
-	(graph_system_memory == 2'd1 && mem_address > 17'h0FFFF) ||
-	(graph_system_memory == 2'd2 && (mem_address < 17'h10000 || mem_address > 17'h17FFF)) ||
-	(graph_system_memory == 2'd3 && mem_address < 17'h17FFF);
+	(graph_system_memory == 2'd1 && host_mem_address > 17'h0FFFF) ||
+	(graph_system_memory == 2'd2 && (host_mem_address < 17'h10000 || host_mem_address > 17'h17FFF)) ||
+	(graph_system_memory == 2'd3 && host_mem_address < 17'h17FFF);
 
 wire [16:0] host_address_reduced =
-	(graph_system_memory == 2'd1)?  { 1'b0, mem_address[15:0] } :
-	(graph_system_memory == 2'd2)?  { 2'b0, mem_address[14:0] } :
-	(graph_system_memory == 2'd3)?  { 2'b0, mem_address[14:0] } :
-                                    mem_address;
+	(graph_system_memory == 2'd1)?  { 1'b0, host_mem_address[15:0] } :
+	(graph_system_memory == 2'd2)?  { 2'b0, host_mem_address[14:0] } :
+	(graph_system_memory == 2'd3)?  { 2'b0, host_mem_address[14:0] } :
+                                    host_mem_address;
 
-wire [15:0] host_address =
-	(seq_access_chain4)?                { host_address_reduced[15:2], 2'b00 } :
-	(~(seq_access_odd_even_disabled))?  { host_address_reduced[15:1], 1'b0 } :
-                                        host_address_reduced[15:0];
+wire [13:0] host_address = host_address_reduced[15:2];
 
 assign vga_memmode = {general_enable_ram, graph_system_memory};
 
 //------------------------------------------------------------------------------ mem read
 
-wire [7:0] host_ram0_q;
-wire [7:0] host_ram1_q;
-wire [7:0] host_ram2_q;
-wire [7:0] host_ram3_q;
+wire [31:0] host_ram0_q;
+wire [31:0] host_ram1_q;
+wire [31:0] host_ram2_q;
+wire [31:0] host_ram3_q;
 
 reg [7:0] host_ram0_reg;
 reg [7:0] host_ram1_reg;
 reg [7:0] host_ram2_reg;
 reg [7:0] host_ram3_reg;
 
+wire [31:0] host_latches = { host_ram3_reg, host_ram2_reg, host_ram1_reg, host_ram0_reg };
+
 reg host_read_out_of_bounds;
 always @(posedge clk_sys) begin
 	if(~rst_n)                                           host_read_out_of_bounds <= 1'b0;
@@ -835,10 +845,10 @@ always @(posedge clk_sys) begin
 	else                                                 host_read_out_of_bounds <= 1'b0;
 end
 
-reg [16:0] host_address_reduced_last;
+reg [3:0] host_byteenable_last;
 always @(posedge clk_sys) begin
-	if(~rst_n)              host_address_reduced_last <= 17'd0;
-	else if(mem_read_valid) host_address_reduced_last <= host_address_reduced;
+	if(~rst_n)              host_byteenable_last <= 4'd0;
+	else if(mem_read_valid) host_byteenable_last <= mem_byteenable;
 end
 
 reg host_read_last;
@@ -847,38 +857,92 @@ always @(posedge clk_sys) begin
 	else         host_read_last <= mem_read_valid && ~(host_memory_out_of_bounds);
 end
 
-wire [7:0] host_read_mode_1 = {
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[7] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[7] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[7] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[7] ^ graph_color_compare_map[3]) : 1'b1),
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[6] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[6] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[6] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[6] ^ graph_color_compare_map[3]) : 1'b1),
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[5] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[5] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[5] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[5] ^ graph_color_compare_map[3]) : 1'b1),
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[4] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[4] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[4] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[4] ^ graph_color_compare_map[3]) : 1'b1),
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[3] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[3] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[3] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[3] ^ graph_color_compare_map[3]) : 1'b1),
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[2] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[2] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[2] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[2] ^ graph_color_compare_map[3]) : 1'b1),
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[1] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[1] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[1] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[1] ^ graph_color_compare_map[3]) : 1'b1),
-	(graph_color_compare_dont_care[0]? ~(host_ram0_q[0] ^ graph_color_compare_map[0]) : 1'b1) & (graph_color_compare_dont_care[1]? ~(host_ram1_q[0] ^ graph_color_compare_map[1]) : 1'b1) &
-	(graph_color_compare_dont_care[2]? ~(host_ram2_q[0] ^ graph_color_compare_map[2]) : 1'b1) & (graph_color_compare_dont_care[3]? ~(host_ram3_q[0] ^ graph_color_compare_map[3]) : 1'b1)
-};
+//------------------------------------------------------------------------------ mem write
 
-assign mem_readdata =
-	(host_read_out_of_bounds)                                                               ? 8'hFF      :
-	(seq_access_chain4 && host_address_reduced_last[1:0] == 2'b00)                          ? host_ram0_q:
-	(seq_access_chain4 && host_address_reduced_last[1:0] == 2'b01)                          ? host_ram1_q:
-	(seq_access_chain4 && host_address_reduced_last[1:0] == 2'b10)                          ? host_ram2_q:
-	(seq_access_chain4 && host_address_reduced_last[1:0] == 2'b11)                          ? host_ram3_q:
-	(~graph_read_mode  && ~(seq_access_odd_even_disabled) && ~host_address_reduced_last[0]) ? host_ram0_q:
-	(~graph_read_mode  && ~(seq_access_odd_even_disabled) && host_address_reduced_last[0])  ? host_ram1_q:
-	(~graph_read_mode  && graph_read_map_select == 2'd0)                                    ? host_ram0_q:
-	(~graph_read_mode  && graph_read_map_select == 2'd1)                                    ? host_ram1_q:
-	(~graph_read_mode  && graph_read_map_select == 2'd2)                                    ? host_ram2_q:
-	(~graph_read_mode  && graph_read_map_select == 2'd3)                                    ? host_ram3_q:
-	                                                                                          host_read_mode_1;
+wire host_write = mem_write && ~(host_memory_out_of_bounds);
+
+wire [127:0] host_byte_writedata;   // byte i, plane p at [(i*4+p)*8 +: 8]
+wire  [15:0] host_byte_write_enable;
+wire   [7:0] host_byte_lane;
+
+genvar host_i;
+generate
+for(host_i = 0; host_i < 4; host_i = host_i + 1) begin : host_byte
+	localparam [1:0] INDEX = host_i;
+
+	wire [1:0] lane =
+		(seq_access_chain4)?                2'd0 :
+		(~(seq_access_odd_even_disabled))?  { INDEX[1], 1'b0 } :
+		                                    INDEX;
+
+	// read: the four planes at this byte's lane
+	wire [7:0] ram0_q = host_ram0_q[lane*8 +: 8];
+	wire [7:0] ram1_q = host_ram1_q[lane*8 +: 8];
+	wire [7:0] ram2_q = host_ram2_q[lane*8 +: 8];
+	wire [7:0] ram3_q = host_ram3_q[lane*8 +: 8];
+
+	wire [7:0] read_mode_1 = ~(
+		({8{graph_color_compare_dont_care[0]}} & (ram0_q ^ {8{graph_color_compare_map[0]}})) |
+		({8{graph_color_compare_dont_care[1]}} & (ram1_q ^ {8{graph_color_compare_map[1]}})) |
+		({8{graph_color_compare_dont_care[2]}} & (ram2_q ^ {8{graph_color_compare_map[2]}})) |
+		({8{graph_color_compare_dont_care[3]}} & (ram3_q ^ {8{graph_color_compare_map[3]}})));
+
+	wire [31:0] planes_q = { ram3_q, ram2_q, ram1_q, ram0_q };
+
+	assign mem_readdata[host_i*8 +: 8] =
+		(host_read_out_of_bounds)                                   ? 8'hFF :
+		(seq_access_chain4)                                         ? planes_q[INDEX*8 +: 8] :
+		(~graph_read_mode && ~(seq_access_odd_even_disabled))       ? planes_q[INDEX[0]*8 +: 8] :
+		(~graph_read_mode)                                          ? planes_q[graph_read_map_select*8 +: 8] :
+		                                                              read_mode_1;
+
+	// write: rotate, set/reset, logical function and bit mask, per plane
+	wire [7:0] data = mem_writedata[host_i*8 +: 8];
+
+	wire [15:0] data_rotate_2 = { data, data } >> graph_write_rotate;
+	wire  [7:0] data_rotate   = data_rotate_2[7:0];
+
+	wire [7:0] set_0 = (graph_write_mode == 2'd2)? {8{data[0]}} : graph_write_enable_map[0]?  {8{graph_write_set_map[0]}} : data_rotate;
+	wire [7:0] set_1 = (graph_write_mode == 2'd2)? {8{data[1]}} : graph_write_enable_map[1]?  {8{graph_write_set_map[1]}} : data_rotate;
+	wire [7:0] set_2 = (graph_write_mode == 2'd2)? {8{data[2]}} : graph_write_enable_map[2]?  {8{graph_write_set_map[2]}} : data_rotate;
+	wire [7:0] set_3 = (graph_write_mode == 2'd2)? {8{data[3]}} : graph_write_enable_map[3]?  {8{graph_write_set_map[3]}} : data_rotate;
+
+	wire [31:0] write_set = { set_3, set_2, set_1, set_0 };
+
+	wire [31:0] function_out =
+		(graph_write_function == 2'd1)? write_set & host_latches :
+		(graph_write_function == 2'd2)? write_set | host_latches :
+		(graph_write_function == 2'd3)? write_set ^ host_latches :
+		                                write_set;
+
+	wire [31:0] write_mask = {4{graph_write_mask}};
+	wire [31:0] masked     = (write_mask & function_out) | (~(write_mask) & host_latches);
+
+	wire [31:0] mode_3_mask = {4{data_rotate & graph_write_mask}};
+	wire [31:0] mode_3      = (mode_3_mask & { {8{graph_write_set_map[3]}}, {8{graph_write_set_map[2]}}, {8{graph_write_set_map[1]}}, {8{graph_write_set_map[0]}} }) |
+	                          (~(mode_3_mask) & host_latches);
+
+	assign host_byte_writedata[host_i*32 +: 32] =
+		(graph_write_mode == 2'd1)? host_latches :
+		(graph_write_mode == 2'd3)? mode_3 :
+		                            masked;
+
+	assign host_byte_write_enable[host_i*4 +: 4] =
+		{4{host_write && mem_byteenable[host_i]}} & seq_map_write_enable & (
+		(seq_access_chain4)?                (4'b0001 << INDEX) :
+		(~(seq_access_odd_even_disabled))?  (4'b0101 << INDEX[0]) :
+		                                    4'b1111);
+
+	assign host_byte_lane[host_i*2 +: 2] = lane;
+end
+endgenerate
+
+// the latches keep the planes at the last byte read, i.e. the highest enabled
+wire [1:0] host_latch_lane =
+	(host_byteenable_last[3])? host_byte_lane[7:6] :
+	(host_byteenable_last[2])? host_byte_lane[5:4] :
+	(host_byteenable_last[1])? host_byte_lane[3:2] :
+	                           host_byte_lane[1:0];
 
 always @(posedge clk_sys) begin
 	if(~rst_n) begin
@@ -886,74 +950,27 @@ always @(posedge clk_sys) begin
 	end
 	else
 	if(host_read_last) begin
-		{ host_ram0_reg, host_ram1_reg, host_ram2_reg, host_ram3_reg } <= { host_ram0_q, host_ram1_q, host_ram2_q, host_ram3_q };
+		{ host_ram0_reg, host_ram1_reg, host_ram2_reg, host_ram3_reg } <=
+			{ host_ram0_q[host_latch_lane*8 +: 8], host_ram1_q[host_latch_lane*8 +: 8], host_ram2_q[host_latch_lane*8 +: 8], host_ram3_q[host_latch_lane*8 +: 8] };
 	end
 end
 
-//------------------------------------------------------------------------------ mem write
-
-wire host_write = mem_write && ~(host_memory_out_of_bounds);
-
-reg  [7:0] host_writedata_rotate;
+// gather the bytes into plane lanes: plane p, lane l at [(p*4+l)*8 +: 8]
+reg [127:0] host_plane_writedata;
+reg  [15:0] host_plane_byteenable;
+integer host_p, host_l, host_src;
 always @(*) begin
-	case(graph_write_rotate)
-		0: host_writedata_rotate =   mem_writedata[7:0];
-		1: host_writedata_rotate = { mem_writedata[0],   mem_writedata[7:1] };
-		2: host_writedata_rotate = { mem_writedata[1:0], mem_writedata[7:2] };
-		3: host_writedata_rotate = { mem_writedata[2:0], mem_writedata[7:3] };
-		4: host_writedata_rotate = { mem_writedata[3:0], mem_writedata[7:4] };
-		5: host_writedata_rotate = { mem_writedata[4:0], mem_writedata[7:5] };
-		6: host_writedata_rotate = { mem_writedata[5:0], mem_writedata[7:6] };
-		7: host_writedata_rotate = { mem_writedata[6:0], mem_writedata[7]   };
-	endcase
-end
-
-
-wire [7:0] host_write_set_0 = (graph_write_mode == 2'd2)? {8{mem_writedata[0]}} : graph_write_enable_map[0]?  {8{graph_write_set_map[0]}} : host_writedata_rotate;
-wire [7:0] host_write_set_1 = (graph_write_mode == 2'd2)? {8{mem_writedata[1]}} : graph_write_enable_map[1]?  {8{graph_write_set_map[1]}} : host_writedata_rotate;
-wire [7:0] host_write_set_2 = (graph_write_mode == 2'd2)? {8{mem_writedata[2]}} : graph_write_enable_map[2]?  {8{graph_write_set_map[2]}} : host_writedata_rotate;
-wire [7:0] host_write_set_3 = (graph_write_mode == 2'd2)? {8{mem_writedata[3]}} : graph_write_enable_map[3]?  {8{graph_write_set_map[3]}} : host_writedata_rotate;
-
-reg [31:0] host_write_function;
-always @(*) begin
-	case(graph_write_function)
-		0: host_write_function = { host_write_set_3, host_write_set_2, host_write_set_1, host_write_set_0 };
-		1: host_write_function = { host_write_set_3, host_write_set_2, host_write_set_1, host_write_set_0 } & { host_ram3_reg, host_ram2_reg, host_ram1_reg, host_ram0_reg };
-		2: host_write_function = { host_write_set_3, host_write_set_2, host_write_set_1, host_write_set_0 } | { host_ram3_reg, host_ram2_reg, host_ram1_reg, host_ram0_reg };
-		3: host_write_function = { host_write_set_3, host_write_set_2, host_write_set_1, host_write_set_0 } ^ { host_ram3_reg, host_ram2_reg, host_ram1_reg, host_ram0_reg };
-	endcase
-end
-
-wire [7:0] host_write_mask_0 = (graph_write_mask & host_write_function[7:0])   | (~(graph_write_mask) & host_ram0_reg);
-wire [7:0] host_write_mask_1 = (graph_write_mask & host_write_function[15:8])  | (~(graph_write_mask) & host_ram1_reg);
-wire [7:0] host_write_mask_2 = (graph_write_mask & host_write_function[23:16]) | (~(graph_write_mask) & host_ram2_reg);
-wire [7:0] host_write_mask_3 = (graph_write_mask & host_write_function[31:24]) | (~(graph_write_mask) & host_ram3_reg);
-
-wire [7:0] host_write_mode_3_mask = host_writedata_rotate & graph_write_mask;
-wire [7:0] host_write_mode_3_ram0 = (host_write_mode_3_mask & {8{graph_write_set_map[0]}})   | (~(host_write_mode_3_mask) & host_ram0_reg);
-wire [7:0] host_write_mode_3_ram1 = (host_write_mode_3_mask & {8{graph_write_set_map[1]}})   | (~(host_write_mode_3_mask) & host_ram1_reg);
-wire [7:0] host_write_mode_3_ram2 = (host_write_mode_3_mask & {8{graph_write_set_map[2]}})   | (~(host_write_mode_3_mask) & host_ram2_reg);
-wire [7:0] host_write_mode_3_ram3 = (host_write_mode_3_mask & {8{graph_write_set_map[3]}})   | (~(host_write_mode_3_mask) & host_ram3_reg);
-
-reg [31:0] host_writedata;
-always @(*) begin
-	case(graph_write_mode)
-		0: host_writedata = { host_write_mask_3,      host_write_mask_2,      host_write_mask_1,      host_write_mask_0 };
-		1: host_writedata = { host_ram3_reg,          host_ram2_reg,          host_ram1_reg,          host_ram0_reg };
-		2: host_writedata = { host_write_mask_3,      host_write_mask_2,      host_write_mask_1,      host_write_mask_0 };
-		3: host_writedata = { host_write_mode_3_ram3, host_write_mode_3_ram2, host_write_mode_3_ram1, host_write_mode_3_ram0 };
-	endcase
+	for(host_p = 0; host_p < 4; host_p = host_p + 1)
+		for(host_l = 0; host_l < 4; host_l = host_l + 1) begin
+			host_src =
+				(seq_access_chain4)?                host_p :
+				(~(seq_access_odd_even_disabled))?  ((host_l & 2) | (host_p & 1)) :
+				                                    host_l;
+			host_plane_writedata[(host_p*4+host_l)*8 +: 8] = host_byte_writedata[(host_src*4+host_p)*8 +: 8];
+			host_plane_byteenable[host_p*4+host_l]         = host_byte_write_enable[host_src*4+host_p] && host_byte_lane[host_src*2 +: 2] == host_l;
+		end
 end
 
-wire [3:0] host_write_enable_for_chain4   = (4'b0001 << host_address_reduced[1:0]);
-wire [3:0] host_write_enable_for_odd_even = (4'b0101 << host_address_reduced[0]);
-                                            
-wire [3:0] host_write_enable = 
-    {4{host_write}} & seq_map_write_enable & (
-    (seq_access_chain4)?                host_write_enable_for_chain4 :
-    (~(seq_access_odd_even_disabled))?  host_write_enable_for_odd_even :
-                                        4'b1111); 
-
 //------------------------------------------------------------------------------ memory address (graph)
 
 wire dot_memory_load_active;
@@ -1066,13 +1083,14 @@ wire [15:0] memory_txt_address = { memory_txt_address_base[2:0], plane_ram0_q[7:
 
 //------------------------------------------------------------------------------ plane ram
 
-dpram_difclk #(16,8) plane_ram_0
+dpram_difclk_w32r8 #(14) plane_ram_0
 (
 	.clk_a          (clk_sys),
 	.address_a      (host_address),
 	.enable_a       (1'b1),
-	.data_a         (host_writedata[7:0]),
-	.wren_a         (general_enable_ram && host_write_enable[0]),
+	.be_a           (host_plane_byteenable[3:0]),
+	.data_a         (host_plane_writedata[31:0]),
+	.wren_a         (general_enable_ram && |host_plane_byteenable[3:0]),
 	.q_a            (host_ram0_q),
 
 	.clk_b          (clk_vga),
@@ -1081,13 +1099,14 @@ dpram_difclk #(16,8) plane_ram_0
 	.q_b            (plane_ram0_q)
 );
 
-dpram_difclk #(16,8) plane_ram_1
+dpram_difclk_w32r8 #(14) plane_ram_1
 (
 	.clk_a          (clk_sys),
 	.address_a      (host_address),
 	.enable_a       (1'b1),
-	.data_a         (host_writedata[15:8]),
-	.wren_a         (general_enable_ram && host_write_enable[1]),
+	.be_a           (host_plane_byteenable[7:4]),
+	.data_a         (host_plane_writedata[63:32]),
+	.wren_a         (general_enable_ram && |host_plane_byteenable[7:4]),
 	.q_a            (host_ram1_q),
 
 	.clk_b          (clk_vga),
@@ -1096,13 +1115,14 @@ dpram_difclk #(16,8) plane_ram_1
 	.q_b            (plane_ram1_q)
 );
 
-dpram_difclk #(16,8) plane_ram_2
+dpram_difclk_w32r8 #(14) plane_ram_2
 (
 	.clk_a          (clk_sys),
 	.address_a      (host_address),
 	.enable_a       (1'b1),
-	.data_a         (host_writedata[23:16]),
-	.wren_a         (general_enable_ram && host_write_enable[2]),
+	.be_a           (host_plane_byteenable[11:8]),
+	.data_a         (host_plane_writedata[95:64]),
+	.wren_a         (general_enable_ram && |host_plane_byteenable[11:8]),
 	.q_a            (host_ram2_q),
 
 	.clk_b          (clk_vga),
@@ -1111,13 +1131,14 @@ dpram_difclk #(16,8) plane_ram_2
 	.q_b            (plane_ram2_q)
 );
 
-dpram_difclk #(16,8) plane_ram_3
+dpram_difclk_w32r8 #(14) plane_ram_3
 (
 	.clk_a          (clk_sys),
 	.address_a      (host_address),
 	.enable_a       (1'b1),
-	.data_a         (host_writedata[31:24]),
-	.wren_a         (general_enable_ram && host_write_enable[3]),
+	.be_a           (host_plane_byteenable[15:12]),
+	.data_a         (host_plane_writedata[127:96]),
+	.wren_a         (general_enable_ram && |host_plane_byteenable[15:12]),
 	.q_a            (host_ram3_q),
 
 	.clk_b          (clk_vga),
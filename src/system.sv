@@ -77,7 +77,7 @@ module system (
 	output [15:0] dbg_reg_dout
 );
 
-wire        a20_enable;
+wire        a20_enable /* verilator public */;
 wire  [7:0] dma_floppy_readdata;
 wire        dma_floppy_tc;
 wire  [7:0] dma_floppy_writedata;
@@ -91,11 +91,11 @@ wire  [7:0] dma_sb_readdata_8;
 wire [15:0] dma_sb_readdata_16;
 wire [15:0] dma_sb_writedata;
 wire [15:0] dma_readdata;
-wire        dma_waitrequest;
-wire [23:0] dma_address;
-wire        dma_read;
+wire        dma_waitrequest /* verilator public */;
+wire [23:0] dma_address /* verilator public */;
+wire        dma_read /* verilator public */;
 wire        dma_readdatavalid;
-wire        dma_write;
+wire        dma_write /* verilator public */;
 wire [15:0] dma_writedata;
 wire        dma_16bit;
 
@@ -107,10 +107,10 @@ wire        mgmt_ide1_cs;
 wire        mgmt_fdd_cs;
 wire        mgmt_rtc_cs;
 
-wire        interrupt_done;
-wire        interrupt_do;
+wire        interrupt_done /* verilator public */;
+wire        interrupt_do /* verilator public */;
 wire  [7:0] interrupt_vector;
-reg  [15:0] interrupt;
+reg  [15:0] interrupt /* verilator public */;
 wire        irq_0, irq_1, irq_2, irq_3, irq_4, irq_5, irq_6, irq_7, irq_8, irq_9, irq_10, irq_12, irq_14, irq_15;
 
 wire        cpu_io_read_do /* verilator public */;
@@ -151,6 +151,8 @@ reg         vga_b_cs;
 reg         vga_c_cs;
 reg         vga_d_cs;
 reg         sysctl_cs;
+reg         debugcon_cs;
+reg         simctl_cs;
 
 wire        fdd0_inserted;
 
@@ -173,15 +175,16 @@ wire [29:0] mem_address /* verilator public */;      // dword address
 wire [31:0] mem_writedata /* verilator public */;
 wire [31:0] mem_readdata /* verilator public */;
 wire  [3:0] mem_byteenable /* verilator public */;
-wire  [3:0] mem_burstcount;
+wire  [3:0] mem_burstcount /* verilator public */;
 wire        mem_write /* verilator public */;
-wire        mem_read;
-wire        mem_waitrequest;
+wire        mem_read /* verilator public */;
+wire        mem_waitrequest /* verilator public */;
 wire        mem_readdatavalid;
 
-wire [16:0] vga_address;
-wire  [7:0] vga_readdata;
-wire  [7:0] vga_writedata;
+wire [16:2] vga_address;      // dword address
+wire  [3:0] vga_byteenable;
+wire [31:0] vga_readdata;
+wire [31:0] vga_writedata;
 wire        vga_read;
 wire        vga_write;
 wire  [2:0] vga_memmode;
@@ -196,6 +199,100 @@ wire  [5:0] video_rd_seg;
 // 	mgmt_write_req_r <= mgmt_write_req;
 // end
 
+`ifdef L2_CACHE
+
+// ao486 -> l2_cache -> sdram_sim 64-bit port. VGA memory is accessed by l2_cache.
+// l2_cache moves one byte at a time over its VGA port, put it on vga.v's dword
+// port with a single byte enabled.
+wire [16:0] l2_vga_address;
+wire  [7:0] l2_vga_writedata;
+reg   [1:0] l2_vga_byte;
+
+assign vga_address    = l2_vga_address[16:2];
+assign vga_byteenable = 4'b0001 << l2_vga_address[1:0];
+assign vga_writedata  = {4{l2_vga_writedata}};
+always @(posedge clk_sys) if (vga_read) l2_vga_byte <= l2_vga_address[1:0];
+
+wire [24:0] ddr_address;
+wire [63:0] ddr_writedata;
+wire [63:0] ddr_readdata;
+wire        ddr_readdatavalid;
+wire  [7:0] ddr_byteenable;
+wire  [7:0] ddr_burstcount;
+wire        ddr_waitrequest;
+wire        ddr_read;
+wire        ddr_write;
+
+l2_cache l2 (
+	.CLK               (clk_sys),
+	.RESET             (reset),
+	.DISABLE           (1'b0),
+
+	.CPU_ADDR          (mem_address),
+	.CPU_DIN           (mem_writedata),
+	.CPU_DOUT          (mem_readdata),
+	.CPU_DOUT_READY    (mem_readdatavalid),
+	.CPU_BE            (mem_byteenable),
+	.CPU_BURSTCNT      (mem_burstcount),
+	.CPU_BUSY          (mem_waitrequest),
+	.CPU_RD            (mem_read),
+	.CPU_WE            (mem_write),
+
+	.DDRAM_ADDR        (ddr_address),
+	.DDRAM_DIN         (ddr_writedata),
+	.DDRAM_DOUT        (ddr_readdata),
+	.DDRAM_DOUT_READY  (ddr_readdatavalid),
+	.DDRAM_BE          (ddr_byteenable),
+	.DDRAM_BURSTCNT    (ddr_burstcount),
+	.DDRAM_BUSY        (ddr_waitrequest),
+	.DDRAM_RD          (ddr_read),
+	.DDRAM_WE          (ddr_write),
+
+	.VGA_ADDR          (l2_vga_address),
+	.VGA_DIN           (vga_readdata[l2_vga_byte*8 +: 8]),
+	.VGA_DOUT          (l2_vga_writedata),
+	.VGA_MODE          (vga_memmode),
+	.VGA_RD            (vga_read),
+	.VGA_WE            (vga_write),
+	.VGA_WR_SEG        (video_wr_seg),
+	.VGA_RD_SEG        (video_rd_seg),
+	.VGA_FB_EN         (video_fb_en),
+
+	.uma_ram           (1'b0)      // ROM segments as in sdram_sim and l1_dcache, see rom_area.vh
+);
+
+sdram_sim sdram (
+    .clk               (clk_sys),
+    .reset             (1'b0),
+
+    .cpu_addr          (dbg_mem_addr),
+    .cpu_din           ({4{dbg_mem_din}}),
+    .cpu_be            (1 << dbg_mem_addr[1:0]),
+    .cpu_burstcount    (8'd1),
+    .cpu_rd            (1'b0),
+    .cpu_we            (dbg_mem_wr),
+
+	.protect_rom       (~reset),
+
+	.vga_readdata      (32'h0),
+	.vga_memmode       (3'd0),
+	.vga_wr_seg        (6'd0),
+	.vga_rd_seg        (6'd0),
+	.vga_fb_en         (1'b0),
+
+	.ddr_addr          (ddr_address),
+	.ddr_din           (ddr_writedata),
+	.ddr_dout          (ddr_readdata),
+	.ddr_dout_ready    (ddr_readdatavalid),
+	.ddr_be            (ddr_byteenable),
+	.ddr_burstcount    (ddr_burstcount),
+	.ddr_busy          (ddr_waitrequest),
+	.ddr_rd            (ddr_read),
+	.ddr_we            (ddr_write)
+);
+
+`else
+
 sdram_sim sdram (
     .clk               (clk_sys),
     .reset             (1'b0),
@@ -213,6 +310,7 @@ sdram_sim sdram (
 	.protect_rom       (~reset),    // when cpu is running, make ROM readonly
 
 	.vga_address       (vga_address),
+	.vga_byteenable    (vga_byteenable),
 	.vga_readdata      (vga_readdata),
 	.vga_writedata     (vga_writedata),
 	.vga_read          (vga_read),
@@ -223,6 +321,8 @@ sdram_sim sdram (
 	.vga_fb_en         (video_fb_en)
 );
 
+`endif
+
 
 ao486 ao486 (
     .clk               (clk_sys),
@@ -293,8 +393,19 @@ always @(posedge clk_sys) begin
 	vga_c_cs      <= ({iobus_address[15:4], 4'd0} == 16'h03C0);
 	vga_d_cs      <= ({iobus_address[15:4], 4'd0} == 16'h03D0);
 	sysctl_cs     <= ({iobus_address[15:0]      } == 16'h8888);
+	debugcon_cs   <= ({iobus_address[15:0]      } == 16'h00E9);
+	simctl_cs     <= ({iobus_address[15:1], 1'd0} == 16'h8890);
 end
 
+`ifdef VERILATOR
+// Host-handled ports: E9 debug console, 8890 exit, 8891 region of interest.
+// See verilator/hostio.cpp.
+import "DPI-C" function void host_io_write(input int address, input int data);
+always @(posedge clk_sys) begin
+	if(iobus_write && (debugcon_cs || simctl_cs)) host_io_write(iobus_address, iobus_writedata[7:0]);
+end
+`endif
+
 reg [7:0] ctlport = 0;
 reg in_reset = 1;
 always @(posedge clk_sys) begin
@@ -322,6 +433,7 @@ wire [7:0] iobus_readdata8 =
 	( ps2_io_cs|ps2_ctl_cs                   ) ? ps2_readdata      :
 	( rtc_cs                                 ) ? rtc_readdata      :
 	( vga_b_cs|vga_c_cs|vga_d_cs             ) ? vga_io_readdata   :
+	( debugcon_cs                            ) ? 8'hE9             :
 	                                             8'hFF;
 
 iobus iobus
@@ -441,16 +553,21 @@ wire [31:0] sd_avs_readdata;
 reg sd_avs_readdatavalid;
 always @(posedge clk_sys) sd_avs_readdatavalid <= sd_avs_read;
 
+// ide0 <-> driver_sd sector data moves IDE_SD_DWORDS dwords per beat
+`ifndef IDE_SD_DWORDS
+`define IDE_SD_DWORDS 4
+`endif
+
 wire [31:0] sd_avm_address;
 wire sd_avm_read;
 reg sd_avm_readdatavalid;
-wire [31:0] sd_avm_readdata;
+wire [32*`IDE_SD_DWORDS-1:0] sd_avm_readdata;
 wire sd_avm_write;
-wire [31:0] sd_avm_writedata;
+wire [32*`IDE_SD_DWORDS-1:0] sd_avm_writedata;
 
 always @(posedge clk_sys) sd_avm_readdatavalid <= sd_avm_read;
 
-ide ide0
+ide #(.SD_DWORDS(`IDE_SD_DWORDS)) ide0
 (
 	.clk               (clk_sys),
 	.rst_n             (1'b1 /*~reset*/),
@@ -489,7 +606,7 @@ ide ide0
     .sd_slave_writedata (sd_avm_writedata)
 );
 
-driver_sd driver_sd
+driver_sd #(.DWORDS(`IDE_SD_DWORDS)) driver_sd
 (
 	.clk               (clk_sys),
 	.rst_n             (~reset),
@@ -651,6 +768,7 @@ vga vga
 	.io_d_cs           (vga_d_cs),
 
 	.mem_address       (vga_address),
+	.mem_byteenable    (vga_byteenable),
 	.mem_read          (vga_read),
 	.mem_readdata      (vga_readdata),
 	.mem_write         (vga_write),
@@ -0,0 +1,170 @@
+// Host acceleration of long REP MOVS/STOS.
+//
+// write.v calls string_accel() through DPI whenever an iteration of a
+// REP MOVS or REP STOS finishes. If the rest of the operation is plain RAM
+// (no paging, not the VGA window or ROM, no overlap, inside segment limits
+// and without offset wrap-around), the host copies up to STRING_ACCEL_CHUNK
+// following elements directly in guest RAM (ram.cpp, which sdram_sim reaches
+// through DPI) and returns their count. The next iteration then advances
+// ESI/EDI/ECX past them, so the instruction ends with exactly the
+// architectural state it would have had. Chunks keep
+// interrupt latency bounded, as interrupts are still taken between
+// iterations.
+//
+// Paging is required to be off, so the TLB holds nothing that could go
+// stale. The caches do not see host writes and are flushed after each
+// chunk.
+//
+// The call writes guest RAM and flushes the caches from inside eval(). That
+// is only safe because Verilator runs non-pure DPI imports one at a time
+// (--threads-dpi pure, set in the Makefile); a build with
+// --threads-dpi all would race with the model threads.
+//
+// The elements done by the host cost no simulated cycles. To keep cycle
+// counts comparable with runs without --fast-string, each chunk is charged
+// what the iteration that applies it took per element; the total is reported
+// at exit and as "accel_cycles" in the benchmark JSON.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+
+#include "Vsystem.h"
+#include "Vsystem_system.h"
+
+#include "accel.h"
+#include "cache.h"
+#include "ram.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+extern uint8_t read_byte(uint32_t addr);
+extern void write_byte(uint32_t addr, uint8_t data);
+
+const uint32_t STRING_ACCEL_CHUNK = 16384;     // elements per call
+
+bool string_accel_enabled = false;
+unsigned string_accel_threshold = 64;
+
+static uint64_t accel_calls, accel_elements, accel_bytes, accel_cycles;
+
+// last chunk, charged when the iteration that skips over it finishes
+static uint32_t charge_elements, charge_ecx;
+static uint64_t charge_time;
+
+struct Segment {
+    uint32_t base, limit;
+    bool writable, expand_down;
+};
+
+static Segment decode_cache(uint64_t c) {
+    Segment s;
+    s.base = (uint32_t)((c >> 16) & 0xFFFFFF) | (uint32_t)((c >> 56) & 0xFF) << 24;
+    uint32_t limit = (uint32_t)(c & 0xFFFF) | (uint32_t)((c >> 48) & 0xF) << 16;
+    s.limit = (c >> 55 & 1) ? (limit << 12) | 0xFFF : limit;
+    bool code = c >> 43 & 1;
+    s.expand_down = !code && (c >> 42 & 1);
+    s.writable = !code && (c >> 41 & 1);
+    return s;
+}
+
+// Offset range [lo, hi] touched by n elements starting at off. False if it wraps.
+static bool offset_range(uint32_t off, uint32_t n, uint32_t size, bool dflag, bool a32, uint32_t &lo, uint32_t &hi) {
+    uint64_t span = (uint64_t)n * size;
+    uint64_t l = dflag ? (uint64_t)off + size - span : off;
+    uint64_t h = l + span - 1;
+    if (dflag && (uint64_t)off + size < span) return false;
+    if (h > (a32 ? 0xFFFFFFFFull : 0xFFFFull)) return false;
+    lo = (uint32_t)l;
+    hi = (uint32_t)h;
+    return true;
+}
+
+// Linear range must be ordinary RAM
+static bool plain_ram(uint32_t lo, uint32_t hi) {
+    bool a20 = tb.system->a20_enable;
+    if (hi >= ram_bytes() || hi < lo) return false;
+    if (!a20 && hi >= 0x100000) return false;
+    if (hi >= 0xA0000 && lo < 0x100000) return false;   // VGA window, option ROMs and BIOS
+    return true;
+}
+
+extern "C" int string_accel(int is_movs, int size, int dflag, int address_32bit, int paging,
+                            int ecx, int eax, int src_linear, int esi, int esi_next, int edi_next,
+                            long long es_cache, long long cs_cache, long long ss_cache,
+                            long long ds_cache, long long fs_cache, long long gs_cache) {
+    if (!string_accel_enabled || paging) return 0;
+
+    // The iteration after a chunk did one element in the RTL and stepped over
+    // the rest; charge those at the cycles that iteration took.
+    if (charge_elements && (uint32_t)ecx == charge_ecx)
+        accel_cycles += (uint64_t)(charge_elements - 1) * ((sim_time - charge_time) / 2);
+    charge_elements = 0;
+
+    bool a32 = address_32bit;
+    uint32_t remaining = a32 ? (uint32_t)ecx : (uint32_t)ecx & 0xFFFF;
+    if (remaining <= string_accel_threshold) return 0;
+    // leave the last element to the RTL so the instruction finishes normally
+    uint32_t n = std::min(remaining - 1, STRING_ACCEL_CHUNK);
+    uint32_t mask = a32 ? 0xFFFFFFFF : 0xFFFF;
+
+    // destination is always ES:EDI
+    Segment es = decode_cache(es_cache);
+    uint32_t dlo, dhi;
+    if (!es.writable || es.expand_down) return 0;
+    if (!offset_range((uint32_t)edi_next & mask, n, size, dflag, a32, dlo, dhi)) return 0;
+    if (dhi > es.limit) return 0;
+    uint32_t dst = es.base + dlo;
+    if (!plain_ram(dst, dst + (dhi - dlo))) return 0;
+
+    uint32_t src = 0;
+    if (is_movs) {
+        // The source segment may be overridden; find it by its base, taking
+        // the smallest limit if several segments share it.
+        uint32_t base = (uint32_t)src_linear - ((uint32_t)esi & mask);
+        bool found = false;
+        uint32_t limit = 0;
+        for (long long c : {es_cache, cs_cache, ss_cache, ds_cache, fs_cache, gs_cache}) {
+            Segment s = decode_cache(c);
+            if (s.base != base || s.expand_down) continue;
+            limit = found ? std::min(limit, s.limit) : s.limit;
+            found = true;
+        }
+        uint32_t slo, shi;
+        if (!found) return 0;
+        if (!offset_range((uint32_t)esi_next & mask, n, size, dflag, a32, slo, shi)) return 0;
+        if (shi > limit) return 0;
+        src = base + slo;
+        if (!plain_ram(src, src + (shi - slo))) return 0;
+        if (src <= dst + (dhi - dlo) && dst <= src + (shi - slo)) return 0;    // overlap
+    }
+
+    uint32_t bytes = n * size;
+    if (is_movs) {
+        for (uint32_t i = 0; i < bytes; i++)
+            write_byte(dst + i, read_byte(src + i));
+    } else {
+        for (uint32_t i = 0; i < bytes; i++)
+            write_byte(dst + i, (uint32_t)eax >> (8 * (i % size)));
+    }
+
+    flush_caches();
+
+    accel_calls++;
+    accel_elements += n;
+    accel_bytes += bytes;
+    charge_elements = n;
+    charge_ecx = (uint32_t)ecx - n;
+    charge_time = sim_time;
+    return n;
+}
+
+void string_accel_report() {
+    if (!string_accel_enabled) return;
+    printf("Fast string: %llu chunks, %llu elements, %llu bytes done by host, about %llu cycles skipped\n",
+           (unsigned long long)accel_calls, (unsigned long long)accel_elements, (unsigned long long)accel_bytes,
+           (unsigned long long)accel_cycles);
+}
+
+uint64_t string_accel_elements() { return accel_elements; }
+uint64_t string_accel_cycles() { return accel_cycles; }
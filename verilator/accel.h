@@ -0,0 +1,11 @@
+#pragma once
+
+// Host acceleration of long REP MOVS/STOS, see accel.cpp
+extern bool string_accel_enabled;
+extern unsigned string_accel_threshold;
+
+void string_accel_report();
+
+// Totals so far, for the benchmark report
+uint64_t string_accel_elements();
+uint64_t string_accel_cycles();
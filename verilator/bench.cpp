@@ -0,0 +1,256 @@
+// Scripted benchmark workloads with machine-readable throughput reports.
+//
+// A workload is a text file with one command per line, executed in order:
+//   wait <text>    wait until the guest prints <text> through INT 10h teletype
+//   type <text>    type <text> on the PS/2 keyboard (\r \n \t \s \\ escapes)
+//   start          start measuring
+//   stop           stop measuring and end the simulation
+//   swap           insert the next --fda floppy image
+//   timebase <Hz>  change the guest timebase (see timebase.cpp)
+// Empty lines and lines starting with '#' are ignored.
+//
+// A guest program can also delimit the measured region itself with the
+// region-of-interest port (see hostio.cpp), which acts like start/stop.
+//
+// The report is a single JSON object. Simulated cycle and instruction counts
+// are deterministic for a given RTL and disk image, so host-side numbers
+// (cycles per second, ns per cycle) are directly comparable across commits.
+// With --fast-string, sim_cycles leaves out what the host-copied elements
+// would have cost; that estimate is reported separately as accel_cycles.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/resource.h>
+
+#include "Vsystem.h"
+#include "Vsystem_ao486.h"
+#include "Vsystem_system.h"
+#include "Vsystem_pipeline.h"
+#include "Vsystem_write.h"
+
+#include "bench.h"
+#include "accel.h"
+#include "floppy.h"
+#include "timebase.h"
+#include "log.h"
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+
+struct BenchCmd {
+    enum { WAIT, TYPE, START, STOP, SWAP, TIMEBASE } op;
+    string arg;
+};
+
+static string bench_name;
+static vector<BenchCmd> cmds;
+static size_t pc;
+static string console;                  // guest output since last wait/type
+
+static bench_clock::time_point process_start = bench_clock::now();
+static double startup_sec;
+
+static bool measuring, finished;
+static bench_clock::time_point host_t0, host_t1;
+static uint64_t sim_t0, sim_t1;
+static uint64_t retired_t0, retired_t1;
+static uint64_t accel_t0, accel_t1, accel_cycles_t0, accel_cycles_t1;
+
+static uint64_t retired() {
+    return tb.system->ao486->pipeline_inst->write_inst->retired;
+}
+
+static void measure_start() {
+    measuring = true;
+    host_t0 = bench_clock::now();
+    sim_t0 = sim_time;
+    retired_t0 = retired();
+    accel_t0 = string_accel_elements();
+    accel_cycles_t0 = string_accel_cycles();
+}
+
+static void measure_stop() {
+    measuring = false;
+    finished = true;
+    host_t1 = bench_clock::now();
+    sim_t1 = sim_time;
+    retired_t1 = retired();
+    accel_t1 = string_accel_elements();
+    accel_cycles_t1 = string_accel_cycles();
+}
+
+static string unescape(const string &s) {
+    string r;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\\' && i+1 < s.size()) {
+            char c = s[++i];
+            if (c == 'r' || c == 'n') r += '\r';
+            else if (c == 't') r += '\t';
+            else if (c == 's') r += ' ';
+            else r += c;
+        } else
+            r += s[i];
+    }
+    return r;
+}
+
+bool bench_load(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (!f) { perror(filename); return false; }
+
+    bench_name = filename;
+    size_t slash = bench_name.find_last_of('/');
+    if (slash != string::npos) bench_name = bench_name.substr(slash + 1);
+    size_t dot = bench_name.find_last_of('.');
+    if (dot != string::npos) bench_name = bench_name.substr(0, dot);
+
+    char line[256];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        string l(line);
+        while (!l.empty() && (l.back() == '\n' || l.back() == '\r')) l.pop_back();
+        if (l.empty() || l[0] == '#') continue;
+        size_t sp = l.find(' ');
+        string op = l.substr(0, sp);
+        string arg = sp == string::npos ? "" : l.substr(sp + 1);
+        if (op == "wait" && !arg.empty())  cmds.push_back({BenchCmd::WAIT, arg});
+        else if (op == "type")             cmds.push_back({BenchCmd::TYPE, unescape(arg)});
+        else if (op == "start")            cmds.push_back({BenchCmd::START, ""});
+        else if (op == "stop")             cmds.push_back({BenchCmd::STOP, ""});
+        else if (op == "swap")             cmds.push_back({BenchCmd::SWAP, ""});
+        else if (op == "timebase" && atoi(arg.c_str()) > 0) cmds.push_back({BenchCmd::TIMEBASE, arg});
+        else {
+            printf("%s:%d: unknown command: %s\n", filename, lineno, l.c_str());
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    printf("Benchmark %s: %zu commands\n", bench_name.c_str(), cmds.size());
+    return true;
+}
+
+bool bench_active() {
+    return !cmds.empty();
+}
+
+void bench_output(char c) {
+    if (!bench_active()) return;
+    console += c;
+    if (console.size() > 4096)
+        console.erase(0, console.size() - 1024);
+}
+
+// Advance the workload script. Returns false once the workload is done.
+// Text to be typed by the guest keyboard is appended to `keys`.
+bool bench_poll(string &keys) {
+    while (pc < cmds.size()) {
+        const BenchCmd &c = cmds[pc];
+        switch (c.op) {
+        case BenchCmd::WAIT:
+            if (console.find(c.arg) == string::npos)
+                return true;
+            LOG(CAT_SIM, LVL_INFO, "%8lld: Benchmark: got \"%s\"\n", sim_time, c.arg.c_str());
+            console.clear();
+            break;
+        case BenchCmd::TYPE:
+            keys += c.arg;
+            console.clear();
+            break;
+        case BenchCmd::START:
+            measure_start();
+            LOG(CAT_SIM, LVL_INFO, "%8lld: Benchmark: start\n", sim_time);
+            break;
+        case BenchCmd::STOP:
+            measure_stop();
+            LOG(CAT_SIM, LVL_INFO, "%8lld: Benchmark: stop\n", sim_time);
+            pc = cmds.size();
+            return false;
+        case BenchCmd::SWAP:
+            floppy_swap();
+            LOG(CAT_SIM, LVL_INFO, "%8lld: Benchmark: floppy swap\n", sim_time);
+            console.clear();
+            break;
+        case BenchCmd::TIMEBASE:
+            timebase_set(strtoul(c.arg.c_str(), nullptr, 0));
+            break;
+        }
+        pc++;
+    }
+    return true;
+}
+
+// Region-of-interest markers from the guest
+void bench_roi_begin() {
+    measure_start();
+    LOG(CAT_SIM, LVL_INFO, "%8lld: Benchmark: ROI begin\n", sim_time);
+}
+
+void bench_roi_end() {
+    if (!measuring) return;
+    measure_stop();
+    LOG(CAT_SIM, LVL_INFO, "%8lld: Benchmark: ROI end, %llu cycles, %llu instructions\n", sim_time,
+           (unsigned long long)(sim_t1 - sim_t0) / 2, (unsigned long long)(retired_t1 - retired_t0));
+}
+
+// Called when the CPU leaves reset. Measurement defaults to starting here
+// if the workload has no explicit "start".
+void bench_startup_done() {
+    host_t0 = bench_clock::now();
+    startup_sec = chrono::duration<double>(host_t0 - process_start).count();
+    sim_t0 = sim_time;
+    retired_t0 = retired();
+    accel_t0 = string_accel_elements();
+    accel_cycles_t0 = string_accel_cycles();
+    measuring = true;
+}
+
+static long peak_rss_kb() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;         // bytes on macOS
+#else
+    return ru.ru_maxrss;                // KB on Linux
+#endif
+}
+
+void bench_report(const char *filename) {
+    if (measuring) {                    // simulation ended before "stop"
+        host_t1 = bench_clock::now();
+        sim_t1 = sim_time;
+        retired_t1 = retired();
+        accel_t1 = string_accel_elements();
+        accel_cycles_t1 = string_accel_cycles();
+    }
+    double host_sec = chrono::duration<double>(host_t1 - host_t0).count();
+    uint64_t cycles = (sim_t1 - sim_t0) / 2;     // sim_time counts clock edges
+    uint64_t insns = retired_t1 - retired_t0;
+
+    FILE *f = fopen(filename, "w");
+    if (!f) { perror(filename); return; }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"workload\": \"%s\",\n", bench_name.empty() ? "roi" : bench_name.c_str());
+    fprintf(f, "  \"completed\": %s,\n", finished ? "true" : "false");
+    fprintf(f, "  \"sim_cycles\": %llu,\n", (unsigned long long)cycles);
+    fprintf(f, "  \"instructions\": %llu,\n", (unsigned long long)insns);
+    fprintf(f, "  \"ipc\": %.4f,\n", cycles ? (double)insns / cycles : 0.0);
+    fprintf(f, "  \"accel_elements\": %llu,\n", (unsigned long long)(accel_t1 - accel_t0));
+    fprintf(f, "  \"accel_cycles\": %llu,\n", (unsigned long long)(accel_cycles_t1 - accel_cycles_t0));
+    fprintf(f, "  \"host_seconds\": %.3f,\n", host_sec);
+    fprintf(f, "  \"cycles_per_second\": %.1f,\n", host_sec > 0 ? cycles / host_sec : 0.0);
+    fprintf(f, "  \"ns_per_cycle\": %.2f,\n", cycles ? host_sec * 1e9 / cycles : 0.0);
+    fprintf(f, "  \"peak_rss_kb\": %ld,\n", peak_rss_kb());
+    fprintf(f, "  \"startup_seconds\": %.3f\n", startup_sec);
+    fprintf(f, "}\n");
+    fclose(f);
+    printf("Benchmark report written to %s\n", filename);
+}
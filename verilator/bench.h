@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// Scripted benchmark workloads, see bench.cpp
+bool bench_load(const char *filename);
+bool bench_active();
+void bench_output(char c);
+bool bench_poll(std::string &keys);
+void bench_roi_begin();
+void bench_roi_end();
+void bench_startup_done();
+void bench_report(const char *filename);
@@ -0,0 +1,81 @@
+// Cache maintenance and statistics (caches and TLB) for the simulation harness.
+//
+// The harness writes guest memory directly in ram.cpp, behind sdram_sim's
+// DPI port (HLE disk services, fast string copies). The caches do not snoop
+// those writes, so such code calls flush_caches() afterwards. It invalidates
+// the L1 instruction cache, the L1 data cache in L1_DCACHE builds and the L2
+// cache in L2_CACHE builds.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <svdpi.h>
+
+#include "Vsystem.h"
+#include "Vsystem_system.h"
+#include "Vsystem_ao486.h"
+#include "Vsystem_memory.h"
+#include "Vsystem_tlb.h"
+#ifdef L1_DCACHE
+#include "Vsystem_l1_dcache.h"
+#endif
+#ifdef L2_CACHE
+#include "Vsystem_l2_cache.h"
+#endif
+
+#include "cache.h"
+#include "log.h"
+
+extern Vsystem tb;
+
+extern "C" {
+    void icache_flush();
+#ifdef L1_DCACHE
+    void dcache_flush();
+#endif
+#ifdef L2_CACHE
+    void l2_flush();
+#endif
+}
+
+void flush_caches() {
+    svSetScope(svGetScopeFromName("TOP.system.ao486.memory_inst.icache_inst.l1_icache_inst"));
+    icache_flush();
+#ifdef L1_DCACHE
+    svSetScope(svGetScopeFromName("TOP.system.ao486.memory_inst.dcache_inst"));
+    dcache_flush();
+#endif
+#ifdef L2_CACHE
+    svSetScope(svGetScopeFromName("TOP.system.l2"));
+    l2_flush();
+#endif
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+void cache_report() {
+    auto *tlb = tb.system->ao486->memory_inst->tlb_inst;
+    uint64_t t_hits = tlb->stat_hits, t_misses = tlb->stat_misses, walk = tlb->stat_walk_cycles;
+    if (t_hits + t_misses)
+        LOG(CAT_SIM, LVL_INFO, "TLB: %llu lookups, %llu misses (%.2f%% hit rate), %llu page walk cycles (%.1f per miss)\n",
+            (unsigned long long)(t_hits + t_misses), (unsigned long long)t_misses, percent(t_hits, t_hits + t_misses),
+            (unsigned long long)walk, t_misses ? (double)walk / t_misses : 0.0);
+#ifdef L1_DCACHE
+    auto *l1d = tb.system->ao486->memory_inst->dcache_inst;
+    uint64_t d_reads = l1d->stat_reads, d_misses = l1d->stat_misses;
+    LOG(CAT_SIM, LVL_INFO, "L1D: %llu reads, %llu line fills (%.2f%% hit rate), %llu uncached reads, %llu snooped writes to cached lines, "
+        "%llu snoop overflows\n",
+        (unsigned long long)d_reads, (unsigned long long)d_misses, 100.0 - percent(d_misses, d_reads),
+        (unsigned long long)(uint64_t)l1d->stat_uncached, (unsigned long long)(uint64_t)l1d->stat_snoop_hits,
+        (unsigned long long)(uint64_t)l1d->stat_overflows);
+#endif
+#ifdef L2_CACHE
+    auto *l2 = tb.system->l2;
+    uint64_t reads = l2->stat_reads, misses = l2->stat_misses;
+    uint64_t writes = l2->stat_writes, write_hits = l2->stat_write_hits;
+    LOG(CAT_SIM, LVL_INFO, "L2: %llu reads, %llu misses (%.2f%% hit rate), %llu writes (%.2f%% hit, written through), %llu VGA accesses\n",
+        (unsigned long long)reads, (unsigned long long)misses, 100.0 - percent(misses, reads),
+        (unsigned long long)writes, percent(write_hits, writes), (unsigned long long)(uint64_t)l2->stat_vga);
+#endif
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Cache maintenance and statistics, see cache.cpp
+void flush_caches();
+void cache_report();
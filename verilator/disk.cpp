@@ -0,0 +1,124 @@
+// Hard disk image behind driver_sd (src/soc/driver_sd_sim.v).
+//
+// The image is a host buffer the size of the image file. driver_sd reads and
+// writes it a dword at a time through the DPI functions below (vdisk.cpp
+// takes their place with --vdisk), and the INT 13h emulation (hle.cpp) goes
+// through disk_read_byte()/disk_write_byte(). Keeping it out of the model
+// means snapshots store it separately, and the timeline (timeline.cpp) does
+// not have to serialize and compare the whole disk at every checkpoint.
+// Instead, writes mark their 512-byte sector dirty, as ram.cpp does for RAM
+// pages, and the timeline saves only those.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
+
+#include "disk.h"
+
+static std::vector<uint8_t> image;
+static std::vector<bool> dirty;
+
+bool disk_load(const char *filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0) { perror(filename); return false; }
+    if ((uint64_t)st.st_size > DISK_MAX_BYTES) {
+        printf("Disk image %s is larger than %u MB\n", filename, DISK_MAX_BYTES >> 20);
+        return false;
+    }
+    FILE *f = fopen(filename, "rb");
+    if (!f) { perror(filename); return false; }
+    image.assign(st.st_size, 0);
+    if (fread(image.data(), 1, image.size(), f) != image.size())
+        printf("Short read from %s\n", filename);
+    fclose(f);
+    dirty.assign(disk_sectors(), false);
+    return true;
+}
+
+uint32_t disk_bytes() {
+    return image.size();
+}
+
+const uint8_t *disk_data() {
+    return image.data();
+}
+
+uint8_t disk_read_byte(uint32_t addr) {
+    return addr < image.size() ? image[addr] : 0;
+}
+
+void disk_write_byte(uint32_t addr, uint8_t data) {
+    if (addr >= image.size()) return;
+    image[addr] = data;
+    dirty[addr / DISK_SECTOR_BYTES] = true;
+}
+
+uint32_t disk_sectors() {
+    return (image.size() + DISK_SECTOR_BYTES - 1) / DISK_SECTOR_BYTES;
+}
+
+bool disk_sector_dirty(uint32_t sector) {
+    bool d = dirty[sector];
+    dirty[sector] = false;
+    return d;
+}
+
+// A partial last sector is padded with zeros
+const uint8_t *disk_sector(uint32_t sector) {
+    static uint8_t last[DISK_SECTOR_BYTES];
+    size_t off = (size_t)sector * DISK_SECTOR_BYTES;
+    if (off + DISK_SECTOR_BYTES <= image.size()) return &image[off];
+    memset(last, 0, sizeof(last));
+    memcpy(last, &image[off], image.size() - off);
+    return last;
+}
+
+void disk_set_sector(uint32_t sector, const uint8_t *data) {
+    size_t off = (size_t)sector * DISK_SECTOR_BYTES;
+    memcpy(&image[off], data, std::min<size_t>(DISK_SECTOR_BYTES, image.size() - off));
+    dirty[sector] = true;
+}
+
+// DPI, see driver_sd_sim.v. Addresses are byte addresses of a dword, outside
+// of the image reads return 0 and writes are dropped.
+extern "C" unsigned int disk_read_dword(unsigned int addr) {
+    uint32_t v = 0;
+    if (addr + 4 <= image.size()) memcpy(&v, &image[addr], 4);
+    return v;
+}
+
+extern "C" void disk_write_dword(unsigned int addr, unsigned int data) {
+    if (addr + 4 > image.size()) return;
+    memcpy(&image[addr], &data, 4);
+    dirty[addr / DISK_SECTOR_BYTES] = true;
+}
+
+#ifdef SIM_SAVABLE
+
+// size in bytes, then the whole image
+void disk_save(VerilatedSerialize &os) {
+    uint32_t size = image.size();
+    os << size;
+    os.write(image.data(), size);
+}
+
+bool disk_restore(VerilatedDeserialize &os) {
+    uint32_t size;
+    os >> size;
+    if (size > DISK_MAX_BYTES) {
+        printf("Bad disk image size %u in snapshot\n", size);
+        return false;
+    }
+    image.assign(size, 0);
+    os.read(image.data(), size);
+    dirty.assign(disk_sectors(), true);
+    return true;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// Hard disk image behind driver_sd, see disk.cpp
+const uint32_t DISK_MAX_BYTES = 1u << 30;      // driver_sd's 30-bit byte pointer
+const int DISK_SECTOR_BYTES = 512;
+
+bool disk_load(const char *filename);
+uint32_t disk_bytes();
+const uint8_t *disk_data();
+
+uint8_t disk_read_byte(uint32_t addr);
+void disk_write_byte(uint32_t addr, uint8_t data);
+
+// sectors written since the timeline last asked
+uint32_t disk_sectors();
+bool disk_sector_dirty(uint32_t sector);
+const uint8_t *disk_sector(uint32_t sector);
+void disk_set_sector(uint32_t sector, const uint8_t *data);
+
+class VerilatedSerialize;
+class VerilatedDeserialize;
+void disk_save(VerilatedSerialize &os);
+bool disk_restore(VerilatedDeserialize &os);
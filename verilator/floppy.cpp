@@ -0,0 +1,284 @@
+// Floppy image backend for floppy.v.
+//
+// floppy.v does not store any media itself. Its management port (0xF2xx,
+// drive B at 0xF28x) takes the geometry of the inserted disk:
+//   0  media present        3  sectors per track
+//   1  write protect        4  total sector count
+//   2  cylinders            5  heads
+// and when a command reaches the data phase it raises `request` (bit 0 read,
+// bit 1 write or format) and waits for the host to fill or drain its 512-byte
+// FIFO at address 0xF. Reading address 0 returns {drive, sector}.
+//
+// Images are mmap'd privately. A request is served straight from the
+// mapping, one FIFO byte per clock with the mgmt strobe held, so a sector
+// costs the host the same 512 cycles it costs the controller, and the main
+// loop keeps running in between. Sectors written by the guest are marked
+// dirty and only those are written back to the file, on swap, WIN-S and exit.
+//
+// Every --fda adds an image to the set for drive A. WIN-F (or `swap` in a
+// benchmark script) ejects the current one and inserts the next.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Vsystem.h"
+
+#include "floppy.h"
+#include "log.h"
+
+using namespace std;
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+extern void step();
+
+struct FloppyFormat {
+    uint32_t kb;
+    uint8_t cylinders, heads, spt;
+    uint8_t cmos;               // CMOS 0x10 drive type
+};
+
+static const FloppyFormat formats[] = {
+    { 160, 40, 1,  8, 1}, { 180, 40, 1,  9, 1},
+    { 320, 40, 2,  8, 1}, { 360, 40, 2,  9, 1},
+    { 720, 80, 2,  9, 3}, {1200, 80, 2, 15, 2},
+    {1440, 80, 2, 18, 4}, {1680, 80, 2, 21, 4},    // DMF
+    {2880, 80, 2, 36, 5},
+};
+
+struct FloppyImage {
+    string name;
+    int fd = -1;
+    uint8_t *data = nullptr;
+    size_t size = 0;
+    bool wp = false;
+    const FloppyFormat *fmt = nullptr;
+    vector<bool> dirty;
+};
+
+static vector<string> image_set;
+static size_t current;
+static FloppyImage img;
+static bool swap_pending;
+
+struct MgmtWrite { uint16_t address; uint32_t data; };
+static deque<MgmtWrite> mgmt_queue;
+
+static enum { IDLE, MGMT, FILL, DRAIN, DONE } state;
+static uint32_t xfer_lba;
+static int xfer_pos;
+static uint8_t *xfer_buf;
+static uint8_t scratch[512];    // sectors beyond the end of the image
+
+static const uint16_t MGMT_FDD  = 0xF200;
+static const uint16_t MGMT_FIFO = 0xF20F;
+
+static const FloppyFormat *find_format(size_t size) {
+    for (const FloppyFormat &f : formats)
+        if ((size_t)f.kb * 1024 == size) return &f;
+    return nullptr;
+}
+
+bool floppy_add_image(const char *filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0) { perror(filename); return false; }
+    if (!find_format(st.st_size)) {
+        printf("%s: unsupported floppy image size %lld\n", filename, (long long)st.st_size);
+        return false;
+    }
+    image_set.push_back(filename);
+    return true;
+}
+
+bool floppy_mounted() {
+    return !image_set.empty();
+}
+
+// The drive is sized for the largest image of the set
+int floppy_cmos_type() {
+    int type = 0;
+    for (const string &name : image_set) {
+        struct stat st;
+        const FloppyFormat *f = stat(name.c_str(), &st) == 0 ? find_format(st.st_size) : nullptr;
+        if (f && f->cmos > type) type = f->cmos;
+    }
+    return type;
+}
+
+void floppy_flush() {
+    if (!img.data || img.wp) return;
+    uint32_t sectors = img.size / 512, written = 0;
+    for (uint32_t s = 0; s < sectors; ) {
+        if (!img.dirty[s]) { s++; continue; }
+        uint32_t e = s;
+        while (e < sectors && img.dirty[e]) img.dirty[e++] = false;
+        if (pwrite(img.fd, img.data + s * 512, (e - s) * 512, (off_t)s * 512) != (ssize_t)(e - s) * 512)
+            LOG(CAT_DISK, LVL_ERROR, "Floppy: write back to %s failed\n", img.name.c_str());
+        written += e - s;
+        s = e;
+    }
+    if (written)
+        LOG(CAT_DISK, LVL_INFO, "Floppy: %u dirty sectors written back to %s\n", written, img.name.c_str());
+}
+
+static void eject() {
+    if (!img.data) return;
+    floppy_flush();
+    munmap(img.data, img.size);
+    close(img.fd);
+    img = FloppyImage();
+}
+
+static bool insert(const string &name) {
+    FloppyImage m;
+    m.name = name;
+    m.fd = open(name.c_str(), O_RDWR);
+    if (m.fd < 0) {
+        m.fd = open(name.c_str(), O_RDONLY);
+        m.wp = true;
+    }
+    struct stat st;
+    if (m.fd < 0 || fstat(m.fd, &st) != 0) { perror(name.c_str()); return false; }
+    m.size = st.st_size;
+    m.fmt = find_format(m.size);
+    if (!m.fmt) {
+        LOG(CAT_DISK, LVL_ERROR, "Floppy: %s: unsupported image size\n", name.c_str());
+        close(m.fd);
+        return false;
+    }
+    // private mapping: guest writes stay in memory until floppy_flush()
+    void *p = mmap(nullptr, m.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m.fd, 0);
+    if (p == MAP_FAILED) { perror(name.c_str()); close(m.fd); return false; }
+    m.data = (uint8_t *)p;
+    m.dirty.assign(m.size / 512, false);
+    img = std::move(m);
+
+    // present goes low for a write first, so the controller sees a disk change
+    mgmt_queue.push_back({MGMT_FDD + 0, 0});
+    mgmt_queue.push_back({MGMT_FDD + 1, img.wp});
+    mgmt_queue.push_back({MGMT_FDD + 2, img.fmt->cylinders});
+    mgmt_queue.push_back({MGMT_FDD + 3, img.fmt->spt});
+    mgmt_queue.push_back({MGMT_FDD + 4, (uint32_t)(img.size / 512)});
+    mgmt_queue.push_back({MGMT_FDD + 5, img.fmt->heads});
+    mgmt_queue.push_back({MGMT_FDD + 0, 1});
+    LOG(CAT_DISK, LVL_INFO, "Floppy: A: %s, %u KB, C/H/S = %d/%d/%d%s\n", name.c_str(), img.fmt->kb,
+        img.fmt->cylinders, img.fmt->heads, img.fmt->spt, img.wp ? ", write-protected" : "");
+    return true;
+}
+
+// Insert the first image of the set, before the CPU starts
+void floppy_init() {
+    if (image_set.empty() || !insert(image_set[0])) return;
+    if (!tb.clk_sys) step();      // make sure clk=0
+    for (const MgmtWrite &w : mgmt_queue) {
+        tb.mgmt_write = 1;
+        tb.mgmt_address = w.address;
+        tb.mgmt_writedata = w.data;
+        step(); step();
+    }
+    mgmt_queue.clear();
+    tb.mgmt_write = 0;
+    tb.mgmt_address = MGMT_FDD;
+    step(); step();
+}
+
+void floppy_swap() {
+    if (image_set.size() < 2) return;
+    swap_pending = true;
+}
+
+// No transfer or management write in flight: everything the backend still has
+// to do is in the model (fdd_request), so the timeline can checkpoint now.
+bool floppy_idle() {
+    return state == IDLE && mgmt_queue.empty();
+}
+
+// The timeline restored a checkpoint, which was taken while idle
+void floppy_rewound() {
+    state = IDLE;
+}
+
+// Called once per clock, after the rising edge. Inputs set here are sampled
+// at the next rising edge.
+void floppy_tick() {
+    switch (state) {
+    case MGMT:
+        tb.mgmt_write = 0;
+        tb.mgmt_address = MGMT_FDD;
+        state = IDLE;
+        break;
+
+    case FILL:                  // the last edge took xfer_buf[xfer_pos-1]
+        if (xfer_pos == 512) {
+            tb.mgmt_write = 0;
+            tb.mgmt_address = MGMT_FDD;
+            state = DONE;
+        } else
+            tb.mgmt_writedata = xfer_buf[xfer_pos++];
+        break;
+
+    case DRAIN:                 // the last edge popped one byte into mgmt_readdata
+        xfer_buf[xfer_pos++] = tb.mgmt_readdata;
+        if (xfer_pos == 512) {
+            tb.mgmt_read = 0;
+            tb.mgmt_address = MGMT_FDD;
+            if (xfer_buf != scratch && !img.wp)
+                img.dirty[xfer_lba] = true;
+            state = DONE;
+        }
+        break;
+
+    case DONE:                  // request stays up until the state machine moves on
+        if (!tb.fdd_request) state = IDLE;
+        break;
+
+    case IDLE:
+        if (swap_pending) {
+            swap_pending = false;
+            eject();
+            current = (current + 1) % image_set.size();
+            insert(image_set[current]);
+        }
+        if (!mgmt_queue.empty()) {
+            tb.mgmt_write = 1;
+            tb.mgmt_address = mgmt_queue.front().address;
+            tb.mgmt_writedata = mgmt_queue.front().data;
+            mgmt_queue.pop_front();
+            state = MGMT;
+            break;
+        }
+        if (!tb.fdd_request) break;
+        if (tb.mgmt_address != MGMT_FDD) {      // {drive, sector} shows up after this edge
+            tb.mgmt_address = MGMT_FDD;
+            break;
+        }
+        // There is no image for drive B. Its requests are completed like
+        // those beyond the end of the image: reads get zeros, writes are
+        // dropped. Leaving them pending would hang the controller.
+        bool drive_b = tb.mgmt_readdata & 0x8000;
+        xfer_lba = tb.mgmt_readdata & 0x7FFF;
+        xfer_buf = !drive_b && img.data && (xfer_lba + 1) * 512 <= img.size ? img.data + xfer_lba * 512 : scratch;
+        xfer_pos = 0;
+        tb.mgmt_address = MGMT_FIFO;
+        if (tb.fdd_request & 1) {
+            LOG(CAT_DISK, LVL_DEBUG, "%8lld: Floppy: read sector %u%s\n", sim_time, xfer_lba, drive_b ? " (drive B)" : "");
+            if (xfer_buf == scratch) memset(scratch, 0, sizeof(scratch));
+            tb.mgmt_write = 1;
+            tb.mgmt_writedata = xfer_buf[xfer_pos++];
+            state = FILL;
+        } else {
+            LOG(CAT_DISK, LVL_DEBUG, "%8lld: Floppy: write sector %u%s\n", sim_time, xfer_lba, drive_b ? " (drive B)" : "");
+            tb.mgmt_read = 1;
+            state = DRAIN;
+        }
+        break;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Floppy image backend for floppy.v, see floppy.cpp
+bool floppy_add_image(const char *filename);
+bool floppy_mounted();
+int floppy_cmos_type();
+void floppy_init();
+void floppy_tick();
+void floppy_swap();
+void floppy_flush();
+bool floppy_idle();
+void floppy_rewound();
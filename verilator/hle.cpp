@@ -0,0 +1,162 @@
+// High-level emulation of BIOS INT 13h disk services.
+//
+// With --hle-disk, the entry of the BIOS INT 13h handler (F000:85D2) is
+// patched to jump to a small stub at D000:0000. For the first hard disk
+// (DL=80h) and functions 02h/03h (CHS read/write) and 42h/43h (extended
+// read/write), the stub signals the harness with an OUT to HLE_DISK_PORT.
+// The harness then copies sectors directly between the disk image
+// (disk.cpp) and guest memory, and writes the result into the stub's stack
+// frame:
+//   [SS:SP]    handled flag (1: done, 0: let the BIOS do it)
+//   [SS:SP+2]  AX to return
+//   [SS:SP+8]  FLAGS image for IRET, CF=1 on error
+// A completed OUT resets the pipeline after it, so the stub's POPs see these
+// values. Everything else falls through to the original BIOS code.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "Vsystem.h"
+#include "Vsystem_ao486.h"
+#include "Vsystem_system.h"
+#include "Vsystem_pipeline.h"
+
+#include "hle.h"
+#include "disk.h"
+#include "ide.h"
+#include "log.h"
+#include "cache.h"
+#include "vdisk.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+extern bool trace_ide;
+extern int disk_size;
+extern uint8_t read_byte(uint32_t addr);
+extern uint16_t read_word(uint32_t addr);
+extern uint32_t read_dword(uint32_t addr);
+extern void write_byte(uint32_t addr, uint8_t data);
+extern void write_word(uint32_t addr, uint16_t data);
+extern void load_program(uint32_t start_addr, std::vector<uint8_t> &program);
+
+const uint32_t STUB_ADDR = 0xD0000;
+const uint32_t BIOS_INT13 = 0xF85D2;
+
+static std::vector<uint8_t> stub = {
+    0x80, 0xFA, 0x80,               // 00: cmp dl,80h
+    0x75, 0x20,                     // 03: jne fallback
+    0x80, 0xFC, 0x02,               // 05: cmp ah,02h
+    0x74, 0x0F,                     // 08: je trap
+    0x80, 0xFC, 0x03,               // 0A: cmp ah,03h
+    0x74, 0x0A,                     // 0D: je trap
+    0x80, 0xFC, 0x42,               // 0F: cmp ah,42h
+    0x74, 0x05,                     // 12: je trap
+    0x80, 0xFC, 0x43,               // 14: cmp ah,43h
+    0x75, 0x0C,                     // 17: jne fallback
+    0x50,                           // 19: trap: push ax
+    0x6A, 0x00,                     // 1A: push 0
+    0xE6, HLE_DISK_PORT,            // 1C: out HLE_DISK_PORT,al
+    0x58,                           // 1E: pop ax
+    0x85, 0xC0,                     // 1F: test ax,ax
+    0x58,                           // 21: pop ax
+    0x74, 0x01,                     // 22: jz fallback
+    0xCF,                           // 24: iret
+    0xFB,                           // 25: fallback: sti  (instructions replaced by the patch)
+    0x80, 0xFC, 0x4A,               // 26: cmp ah,4Ah
+    0x72, 0x05,                     // 29: jb +5
+    0xEA, 0xD8, 0x85, 0x00, 0xF0,   // 2B: jmp F000:85D8
+    0xEA, 0xE6, 0x85, 0x00, 0xF0,   // 30: jmp F000:85E6
+};
+
+// Install the stub. Must be called while the system is in reset (ROM writable).
+bool hle_disk_install() {
+    const uint8_t expect[] = {0xFB, 0x80, 0xFC, 0x4A, 0x72, 0x0E, 0x80, 0xFC, 0x4D};
+    for (int i = 0; i < (int)sizeof(expect); i++) {
+        if (read_byte(BIOS_INT13 + i) != expect[i]) {
+            printf("HLE: BIOS INT 13h entry not found at F000:%04X, disk HLE disabled\n", BIOS_INT13 & 0xFFFF);
+            return false;
+        }
+    }
+    load_program(STUB_ADDR, stub);
+    std::vector<uint8_t> patch = {0xEA, 0x00, 0x00, 0x00, 0xD0};    // jmp D000:0000
+    load_program(BIOS_INT13, patch);
+    printf("HLE: INT 13h disk services for drive 80h handled by host\n");
+    return true;
+}
+
+// Called when the stub writes HLE_DISK_PORT
+void hle_disk_service() {
+    Vsystem_pipeline *p = tb.system->ao486->pipeline_inst;
+    uint32_t frame = p->ss * 16 + (p->esp & 0xFFFF);
+    uint16_t ax = read_word(frame + 2);         // AX as pushed by the stub
+    uint8_t fn = ax >> 8;
+    uint32_t ecx = p->ecx, edx = p->edx;
+
+    uint32_t cylinders;
+    uint16_t heads, spt;
+    ide_geometry(&cylinders, &heads, &spt);
+
+    uint32_t lba, count, buf;
+    bool ext = fn == 0x42 || fn == 0x43;
+    bool write = fn == 0x03 || fn == 0x43;
+    uint32_t dap = 0;
+    if (ext) {
+        dap = p->ds * 16 + (p->esi & 0xFFFF);
+        count = read_word(dap + 2);
+        buf = read_word(dap + 6) * 16 + read_word(dap + 4);
+        lba = read_dword(dap + 8);
+        if (read_byte(dap) < 0x10 || read_dword(dap + 12) != 0)
+            return;                             // leave unusual requests to the BIOS
+    } else {
+        // BIOS translates CHS for disks with more than 1024 cylinders; let it handle those
+        if (cylinders > 1024 || heads == 0 || spt == 0)
+            return;
+        uint32_t cyl = (ecx >> 8 & 0xFF) | ((ecx & 0xC0) << 2);
+        uint32_t head = edx >> 8 & 0xFF;
+        uint32_t sector = ecx & 0x3F;
+        count = ax & 0xFF;
+        if (sector == 0 || sector > spt || head >= heads || cyl >= cylinders)
+            return;
+        lba = (cyl * heads + head) * spt + sector - 1;
+        buf = p->es * 16 + (p->ebx & 0xFFFF);
+    }
+    uint32_t bytes = count * 512;
+
+    // only plain RAM below the VGA window, and only sectors inside the image
+    if (count == 0 || count > 128 || buf + bytes > 0xA0000 ||
+        (uint64_t)(lba + count) * 512 > (uint64_t)disk_size)
+        return;
+
+    LOG(CAT_DISK, LVL_DEBUG, "%8lld: HLE INT 13h: AH=%02x, LBA=%u, count=%u, buffer=%05x\n", sim_time, fn, lba, count, buf);
+
+    uint32_t pos = lba * 512;
+    if (vdisk_active()) {
+        uint8_t sector[512];
+        for (uint32_t s = 0; s < count; s++, buf += 512) {
+            if (write) {
+                for (int i = 0; i < 512; i++)
+                    sector[i] = read_byte(buf + i);
+                vdisk_write(lba + s, sector);
+            } else {
+                vdisk_read(lba + s, sector);
+                for (int i = 0; i < 512; i++)
+                    write_byte(buf + i, sector[i]);
+            }
+        }
+    } else if (write) {
+        for (uint32_t i = 0; i < bytes; i++)
+            disk_write_byte(pos + i, read_byte(buf + i));
+    } else {
+        for (uint32_t i = 0; i < bytes; i++)
+            write_byte(buf + i, disk_read_byte(pos + i));
+    }
+
+    write_byte(0x474, 0);                       // BDA: last hard disk status
+    write_word(frame, 1);                       // handled
+    write_word(frame + 2, ext ? 0x0000 : count & 0xFF);
+    write_word(frame + 8, read_word(frame + 8) & ~1);   // clear CF
+
+    // code may have been loaded, and the stack frame must not come from a stale L2 line
+    flush_caches();
+}
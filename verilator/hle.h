@@ -0,0 +1,7 @@
+#pragma once
+
+// High-level emulation of BIOS services, see hle.cpp
+const int HLE_DISK_PORT = 0xEC;
+
+bool hle_disk_install();
+void hle_disk_service();
@@ -0,0 +1,81 @@
+// Host-handled I/O ports that let guest software talk to the simulator.
+//
+// They are decoded in system.sv next to sysctl (0x8888) and reported here
+// through the host_io_write DPI function, one call per byte written:
+//   E9h     debug console (Bochs style). Bytes are printed on the host
+//           console. Reading the port returns E9h, for detection.
+//   8890h   exit. Ends the simulation, the byte written is the exit status.
+//   8891h   region of interest. 1 begins it and 0 ends it. The markers
+//           start/stop the benchmark measurement, the --memstat counters and
+//           the --irq-latency statistics, and with --roi-trace also
+//           start/stop waveform tracing.
+//
+// From DOS, e.g.:  mov dx,8890h / mov al,0 / out dx,al
+//
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hostio.h"
+#include "bench.h"
+#include "log.h"
+#include "memstat.h"
+#include "irqstat.h"
+
+extern uint64_t sim_time;
+
+bool roi_trace = false;
+
+static bool exit_requested;
+static int exit_code;
+static bool console_newline = true;
+static int trace_request = -1;
+
+bool sim_exit_requested() {
+    return exit_requested;
+}
+
+int sim_exit_code() {
+    return exit_code;
+}
+
+// Tracing cannot be switched from inside eval(), so ROI markers leave a
+// request that the main loop picks up after the step.
+bool roi_trace_request(bool &on) {
+    if (trace_request < 0) return false;
+    on = trace_request;
+    trace_request = -1;
+    return true;
+}
+
+extern "C" void host_io_write(int address, int data) {
+    uint8_t c = data;
+    switch (address) {
+    case DEBUGCON_PORT:
+        if (log_enabled(CAT_BIOS, LVL_INFO)) {
+            if (console_newline)
+                log_printf("%8lld: E9: ", sim_time);
+            log_printf("\033[36m%c\033[0m", c);
+        }
+        console_newline = c == '\n';
+        bench_output(c);
+        break;
+    case SIM_EXIT_PORT:
+        LOG(CAT_SIM, LVL_INFO, "\n%8lld: Guest requested exit with status %d\n", sim_time, c);
+        exit_requested = true;
+        exit_code = c;
+        break;
+    case SIM_ROI_PORT:
+        if (c) {
+            bench_roi_begin();
+            memstat_reset();
+            irqstat_reset();
+            if (roi_trace) trace_request = 1;
+        } else {
+            if (roi_trace) trace_request = 0;
+            bench_roi_end();
+            memstat_dump();
+            irqstat_report();
+        }
+        break;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host-handled I/O ports for guest software, see hostio.cpp
+const int DEBUGCON_PORT = 0xE9;
+const int SIM_EXIT_PORT = 0x8890;
+const int SIM_ROI_PORT  = 0x8891;
+
+extern bool roi_trace;
+
+bool sim_exit_requested();
+int sim_exit_code();
+bool roi_trace_request(bool &on);
@@ -5,6 +5,8 @@
 #include "Vsystem_ao486.h"
 #include "Vsystem_system.h"
 
+#include "vdisk.h"
+
 extern Vsystem tb;
 extern void step();
 struct PartEntry {
@@ -117,6 +119,16 @@ static void calc_geometry(uint8_t *mbr, uint32_t *cylinders, uint16_t *heads, ui
     printf("IDE: calc_geometry: %u, %u, %u\n", *cylinders, *heads, *spt);
 }
 
+static uint32_t ide_cylinders;
+static uint16_t ide_heads, ide_spt;
+
+// Geometry reported to the BIOS in the identify block
+void ide_geometry(uint32_t *cylinders, uint16_t *heads, uint16_t *spt) {
+    *cylinders = ide_cylinders;
+    *heads = ide_heads;
+    *spt = ide_spt;
+}
+
 // This extracts geometry information from the partition table in the MBR, 
 // constructs the corresponding 512-byte "identify block" for the disk, and
 // then send it to the ao486 ATA/IDE module. 
@@ -126,16 +138,25 @@ void init_ide(const char *filename) {
     uint16_t hd_spt;
     uint32_t hd_total_sectors;
 
-    FILE *f = fopen(filename, "rb");
-    fseek(f, 0, SEEK_END);
-    uint64_t size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    uint64_t size;
     uint8_t mbr[512];
-    fread(mbr, 1, 512, f);
-    fclose(f);
+    if (vdisk_active()) {
+        size = vdisk_bytes();
+        vdisk_read(0, mbr);
+    } else {
+        FILE *f = fopen(filename, "rb");
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        fread(mbr, 1, 512, f);
+        fclose(f);
+    }
 
     calc_geometry(mbr, &hd_cylinders, &hd_heads, &hd_spt, size);
     hd_total_sectors = hd_cylinders * hd_heads * hd_spt;
+    ide_cylinders = hd_cylinders;
+    ide_heads = hd_heads;
+    ide_spt = hd_spt;
 
 	unsigned int identify[256] = {
 		0x0040, 										//word 0
@@ -194,7 +215,7 @@ void init_ide(const char *filename) {
 		hd_spt,											//word 56
 		hd_total_sectors & 0xFFFF,						//word 57
 		hd_total_sectors >> 16,							//word 58
-		0x0000,											//word 59 multiple sectors
+		0x0100 | 16,									//word 59 multiple sectors, enabled at power-on
 		hd_total_sectors & 0xFFFF,						//word 60
 		hd_total_sectors >> 16,							//word 61
 		0x0000,											//word 62 single word dma modes
@@ -1,4 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 void init_ide(const char *filename);
+void ide_geometry(uint32_t *cylinders, uint16_t *heads, uint16_t *spt);
 
@@ -0,0 +1,206 @@
+// Interrupt latency statistics (--irq-latency [N]).
+//
+// Every rising edge of an IRQ line into the PIC is timestamped and followed
+// through three steps: the PIC asserting interrupt_do for it, the CPU
+// acknowledging it (interrupt_done), and the first instruction of the handler
+// retiring. The whole interrupt entry, task switch included, retires as one
+// instruction starting with CMD_int; the handler's first is the one after.
+// Latency is in clock cycles from the edge to that instruction. The report
+// has, per IRQ, the count, min/avg/p99/max, the average time to each step
+// and a log2 histogram.
+//
+// Latencies over N cycles (default 2000) are put down to whatever took the
+// most of their time:
+//   pic     the PIC not asserting it yet: masked, or a higher priority
+//           interrupt in service
+//   cli     asserted, but interrupts disabled
+//   rep     asserted, but a REP string instruction running
+//   hlt     asserted while the CPU wakes up from HLT
+//   entry   the interrupt entry (stack pushes, IVT/IDT, task switch)
+//   other   asserted, and anything else, e.g. a long instruction
+//
+// The statistics are reported at exit and at the end of each region of
+// interest, and reset at its beginning.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "Vsystem.h"
+#include "Vsystem_system.h"
+#include "Vsystem_ao486.h"
+#include "Vsystem_pipeline.h"
+#include "Vsystem_write.h"
+#include "Vsystem_pic.h"
+
+#include "irqstat.h"
+#include "log.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+
+// first micro-op command of an interrupt entry, src/ao486/autogen/defines.v
+static const uint8_t CMD_int = 28;
+
+enum Cause { CAUSE_PIC, CAUSE_CLI, CAUSE_REP, CAUSE_HLT, CAUSE_ENTRY, CAUSE_OTHER, CAUSE_COUNT };
+static const char *cause_names[CAUSE_COUNT] = {"pic", "cli", "rep", "hlt", "entry", "other"};
+
+// one interrupt on its way, times are sim_time, 0 for not yet
+struct Pending {
+    uint64_t raised, asserted, acked;
+    bool halted;                    // CPU in HLT when the line rose
+    uint64_t cli, rep;              // cycles while asserted
+};
+
+struct IrqStat {
+    std::vector<uint32_t> latency;
+    uint64_t to_assert, to_ack, to_handler;
+    uint64_t hist[32];
+    uint64_t long_cause[CAUSE_COUNT];
+    uint64_t unmatched;             // acknowledged without a recorded edge
+};
+
+bool irqstat_enabled = false;
+static uint32_t threshold = 2000;
+static Pending pending[16];
+static IrqStat stats[16];
+static int entering = -1;           // line acknowledged, handler not reached yet
+static bool entry_retired;          // and its interrupt entry has retired
+static uint16_t lines_r;
+static uint64_t retired_r, last_time, start_time;
+static uint64_t cli_cycles, rep_cycles;
+
+void irqstat_set_threshold(uint32_t cycles) {
+    if (cycles) threshold = cycles;
+    irqstat_enabled = true;
+}
+
+void irqstat_reset() {
+    for (IrqStat &s : stats) s = IrqStat();
+    start_time = sim_time;
+}
+
+static void record(int line) {
+    Pending &p = pending[line];
+    IrqStat &s = stats[line];
+    uint64_t pic = (p.asserted - p.raised) / 2;
+    uint64_t ack = (p.acked - p.asserted) / 2;
+    uint64_t entry = (sim_time - p.acked) / 2;
+    uint64_t cycles = pic + ack + entry;
+    s.latency.push_back(std::min<uint64_t>(cycles, UINT32_MAX));
+    s.to_assert += pic;
+    s.to_ack += ack;
+    s.to_handler += entry;
+    int bucket = 0;
+    while (bucket < 31 && (2ull << bucket) <= cycles) bucket++;
+    s.hist[bucket]++;
+
+    if (cycles > threshold) {
+        uint64_t rest = ack - std::min(ack, p.cli + p.rep);
+        uint64_t time[CAUSE_COUNT] = {pic, p.cli, p.rep, p.halted ? rest : 0, entry, p.halted ? 0 : rest};
+        s.long_cause[std::max_element(time, time + CAUSE_COUNT) - time]++;
+    }
+}
+
+// Called after every rising edge of clk_sys
+void irqstat_sample() {
+    Vsystem_system *sys = tb.system;
+    Vsystem_write *w = sys->ao486->pipeline_inst->write_inst;
+
+    if (sim_time < last_time) {     // timeline rewind, drop what was in flight
+        memset(pending, 0, sizeof(pending));
+        entering = -1;
+        entry_retired = false;
+    }
+    last_time = sim_time;
+
+    bool iflag = sys->ao486->pipeline_inst->eflags >> 9 & 1;
+    if (sys->interrupt_do) {
+        if (!iflag) cli_cycles++;
+        else if (w->string_in_progress) rep_cycles++;
+    }
+
+    uint16_t lines = sys->interrupt;
+    uint16_t rising = lines & ~lines_r;
+    lines_r = lines;
+    for (int i = 0; i < 16; i++)
+        if (rising >> i & 1 && !pending[i].raised)
+            pending[i] = {sim_time, 0, 0, (bool)w->halted, 0, 0};
+
+    int line = sys->pic->interrupt_line;
+    Pending &p = pending[line];
+    if (sys->interrupt_do && p.raised && !p.asserted) {
+        p.asserted = sim_time;
+        p.cli = cli_cycles;
+        p.rep = rep_cycles;
+    }
+    if (sys->interrupt_done && entering != line) {
+        if (p.raised) {
+            if (!p.asserted) {
+                p.asserted = sim_time;
+                p.cli = cli_cycles;
+                p.rep = rep_cycles;
+            }
+            p.acked = sim_time;
+            p.cli = cli_cycles - p.cli;
+            p.rep = rep_cycles - p.rep;
+            entering = line;
+            entry_retired = false;
+        } else {
+            stats[line].unmatched++;
+        }
+    }
+
+    uint64_t retired = w->retired;
+    if (retired != retired_r && entering >= 0) {
+        if (!entry_retired) {
+            entry_retired = w->retired_cmd == CMD_int;
+        } else {
+            record(entering);
+            pending[entering] = Pending();
+            entering = -1;
+        }
+    }
+    retired_r = retired;
+}
+
+void irqstat_report() {
+    if (!irqstat_enabled) return;
+    LOG(CAT_SIM, LVL_INFO, "IRQ latency for sim_time %llu-%llu, cycles from the IRQ line rising to the first handler instruction\n",
+        (unsigned long long)start_time, (unsigned long long)sim_time);
+    LOG(CAT_SIM, LVL_INFO, "  %3s %8s %8s %8s %8s %8s | avg to %6s %6s %7s | over %u:", "irq", "count", "min", "avg", "p99", "max",
+        "PIC", "ack", "handler", threshold);
+    for (int c = 0; c < CAUSE_COUNT; c++)
+        LOG(CAT_SIM, LVL_INFO, " %s", cause_names[c]);
+    LOG(CAT_SIM, LVL_INFO, "\n");
+
+    for (int i = 0; i < 16; i++) {
+        IrqStat &s = stats[i];
+        if (s.latency.empty()) {
+            if (s.unmatched)
+                LOG(CAT_SIM, LVL_INFO, "  %3d %8s (%llu acknowledged without a rising edge)\n", i, "-",
+                    (unsigned long long)s.unmatched);
+            continue;
+        }
+        std::vector<uint32_t> &l = s.latency;
+        size_t n = l.size();
+        uint64_t sum = 0;
+        for (uint32_t v : l) sum += v;
+        size_t p99 = std::min(n - 1, n * 99 / 100);
+        std::nth_element(l.begin(), l.begin() + p99, l.end());
+        uint32_t p99_value = l[p99];
+        auto minmax = std::minmax_element(l.begin(), l.end());
+        LOG(CAT_SIM, LVL_INFO, "  %3d %8zu %8u %8llu %8u %8u |        %6llu %6llu %7llu |", i, n, *minmax.first,
+            (unsigned long long)(sum / n), p99_value, *minmax.second, (unsigned long long)(s.to_assert / n),
+            (unsigned long long)(s.to_ack / n), (unsigned long long)(s.to_handler / n));
+        for (int c = 0; c < CAUSE_COUNT; c++)
+            LOG(CAT_SIM, LVL_INFO, " %s=%llu", cause_names[c], (unsigned long long)s.long_cause[c]);
+        LOG(CAT_SIM, LVL_INFO, "\n      histogram:");
+        for (int b = 0; b < 32; b++)
+            if (s.hist[b])
+                LOG(CAT_SIM, LVL_INFO, " <%llu:%llu", 2ull << b, (unsigned long long)s.hist[b]);
+        LOG(CAT_SIM, LVL_INFO, "\n");
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+// Interrupt latency statistics per IRQ line, see irqstat.cpp
+extern bool irqstat_enabled;
+
+void irqstat_set_threshold(uint32_t cycles);
+void irqstat_sample();
+void irqstat_reset();
+void irqstat_report();
@@ -0,0 +1,206 @@
+// Buffered, category-filtered logging.
+//
+// Messages belong to a category (sim, ide, vga, kbd, bios, disk, frame) and
+// a level (error, warn, info, debug), with a runtime level per category
+// set by --log, e.g. "--log ide=debug,frame=warn" or "--log debug". The
+// LOG() macro checks the level before evaluating any argument, so disabled
+// messages cost a load and a compare.
+//
+// Enabled messages are formatted on the calling thread into a bounded
+// lock-free queue of fixed-size slots (Vyukov MPMC, used here as MPSC, as
+// RTL messages may come from any Verilator model thread). A writer thread
+// drains the queue to stdout or the --log-file. A full queue makes the
+// producer wait, so nothing is dropped. A message longer than a slot takes
+// several consecutive ones, reserved together so that messages from other
+// threads cannot end up in the middle of it.
+//
+// RTL code logs through the sim_log DPI functions, see src/common/sim_log.vh.
+//
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "log.h"
+
+int log_levels[CAT_COUNT] = {LVL_INFO, LVL_INFO, LVL_INFO, LVL_INFO, LVL_INFO, LVL_INFO, LVL_INFO};
+
+static const char *category_names[CAT_COUNT] = {"sim", "ide", "vga", "kbd", "bios", "disk", "frame"};
+static const char *level_names[] = {"error", "warn", "info", "debug"};
+
+const size_t LOG_SLOTS = 4096;          // power of 2
+const size_t LOG_SLOT_TEXT = 248;
+
+struct LogSlot {
+    std::atomic<size_t> seq;
+    uint32_t len;
+    char text[LOG_SLOT_TEXT];
+};
+
+static LogSlot slots[LOG_SLOTS];
+static std::atomic<size_t> enqueue_pos;
+static size_t dequeue_pos;
+
+static FILE *log_file = stdout;
+static std::thread writer;
+static std::atomic<bool> running;
+
+// Queue a message in count consecutive slots. The writer frees slots in
+// order, so when the last of them is free all of them are.
+static void enqueue(const char *s, size_t len, size_t count) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        size_t last = pos + count - 1;
+        size_t seq = slots[last & (LOG_SLOTS - 1)].seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)last;
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            std::this_thread::yield();              // full, wait for the writer
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    for (size_t i = 0; i < count; i++, pos++) {
+        LogSlot *slot = &slots[pos & (LOG_SLOTS - 1)];
+        size_t n = len < LOG_SLOT_TEXT ? len : LOG_SLOT_TEXT;
+        memcpy(slot->text, s, n);
+        slot->len = n;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        s += n;
+        len -= n;
+    }
+}
+
+// Single consumer: the writer thread, or the caller of log_stop()
+static bool drain() {
+    bool any = false;
+    for (;;) {
+        LogSlot *slot = &slots[dequeue_pos & (LOG_SLOTS - 1)];
+        if (slot->seq.load(std::memory_order_acquire) != dequeue_pos + 1)
+            break;
+        fwrite(slot->text, 1, slot->len, log_file);
+        slot->seq.store(dequeue_pos + LOG_SLOTS, std::memory_order_release);
+        dequeue_pos++;
+        any = true;
+    }
+    return any;
+}
+
+static void writer_loop() {
+    while (running.load(std::memory_order_acquire)) {
+        if (!drain()) {
+            fflush(log_file);
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+}
+
+void log_write(const char *s, size_t len) {
+    if (!running.load(std::memory_order_relaxed)) {
+        fwrite(s, 1, len, log_file);
+        return;
+    }
+    // a message can take at most half the queue, anything beyond is cut off
+    len = std::min(len, LOG_SLOTS / 2 * LOG_SLOT_TEXT);
+    if (len > 0)
+        enqueue(s, len, (len + LOG_SLOT_TEXT - 1) / LOG_SLOT_TEXT);
+}
+
+void log_printf(const char *fmt, ...) {
+    char buf[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n < sizeof(buf)) {
+        log_write(buf, n);
+        return;
+    }
+    std::string big(n + 1, 0);
+    va_start(ap, fmt);
+    vsnprintf(&big[0], n + 1, fmt, ap);
+    va_end(ap);
+    log_write(big.data(), n);
+}
+
+static int parse_level(const std::string &s) {
+    for (int i = 0; i <= LVL_DEBUG; i++)
+        if (s == level_names[i]) return i;
+    return -1;
+}
+
+// "debug", "ide=debug", "ide=debug,frame=warn", "all=info"
+bool log_configure(const char *spec) {
+    std::string s(spec);
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t comma = s.find(',', start);
+        std::string item = s.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        size_t eq = item.find('=');
+        std::string cat = eq == std::string::npos ? "all" : item.substr(0, eq);
+        int lvl = parse_level(eq == std::string::npos ? item : item.substr(eq + 1));
+        if (lvl < 0) {
+            printf("Bad log level in '%s'\n", item.c_str());
+            return false;
+        }
+        bool found = false;
+        for (int i = 0; i < CAT_COUNT; i++) {
+            if (cat == "all" || cat == category_names[i]) {
+                log_levels[i] = lvl;
+                found = true;
+            }
+        }
+        if (!found) {
+            printf("Unknown log category '%s'\n", cat.c_str());
+            return false;
+        }
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return true;
+}
+
+bool log_open(const char *filename) {
+    FILE *f = fopen(filename, "w");
+    if (!f) { perror(filename); return false; }
+    log_file = f;
+    return true;
+}
+
+void log_start() {
+    for (size_t i = 0; i < LOG_SLOTS; i++)
+        slots[i].seq.store(i, std::memory_order_relaxed);
+    fflush(stdout);
+    running = true;
+    writer = std::thread(writer_loop);
+}
+
+void log_stop() {
+    if (!running) return;
+    running = false;
+    writer.join();
+    drain();
+    fflush(log_file);
+    if (log_file != stdout) fclose(log_file);
+    log_file = stdout;
+}
+
+// DPI functions for RTL messages
+extern "C" int sim_log_enabled(int category, int level) {
+    return category >= 0 && category < CAT_COUNT && log_enabled(category, level);
+}
+
+extern "C" void sim_log(int category, int level, const char *msg) {
+    if (!sim_log_enabled(category, level)) return;
+    log_printf("[%s] %s\n", category_names[category], msg);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+
+// Buffered, category-filtered logging, see log.cpp
+enum LogCategory { CAT_SIM, CAT_IDE, CAT_VGA, CAT_KBD, CAT_BIOS, CAT_DISK, CAT_FRAME, CAT_COUNT };
+enum LogLevel { LVL_ERROR, LVL_WARN, LVL_INFO, LVL_DEBUG };
+
+extern int log_levels[CAT_COUNT];
+
+inline bool log_enabled(int cat, int lvl) {
+    return lvl <= log_levels[cat];
+}
+
+// Arguments are not evaluated when the category is filtered out
+#define LOG(cat, lvl, ...) do { if (log_enabled(cat, lvl)) log_printf(__VA_ARGS__); } while (0)
+
+void log_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void log_write(const char *s, size_t len);
+bool log_configure(const char *spec);
+bool log_open(const char *filename);
+void log_start();
+void log_stop();
@@ -12,8 +12,6 @@
 #include "Vsystem_ao486.h"
 #include "Vsystem_system.h"
 #include "Vsystem_pipeline.h"
-#include "Vsystem_sdram_sim.h"
-#include "Vsystem_driver_sd.h"
 #include <svdpi.h>
 #include <fstream>
 #include <iostream>
@@ -24,6 +22,24 @@
 #include <SDL.h>
 
 #include "ide.h"
+#include "bench.h"
+#include "hle.h"
+#include "accel.h"
+#include "snapshot.h"
+#include "hostio.h"
+#include "log.h"
+#include "memstat.h"
+#include "irqstat.h"
+#include "cache.h"
+#include "ram.h"
+#include "disk.h"
+#include "floppy.h"
+#include "watchdog.h"
+#include "vdisk.h"
+#include "statehash.h"
+#include "timeline.h"
+#include "video.h"
+#include "timebase.h"
 
 using namespace std;
 
@@ -46,9 +62,15 @@ Pixel screenbuffer[H_RES * V_RES];
 
 bool trace_toggle = false;
 void set_trace(bool toggle);
+void close_trace();
 bool trace_vga = false;
 bool trace_ide = false;
 bool trace_post = false;
+bool headless = false;
+bool hle_disk = false;
+string bench_json;
+string save_file = "sim.snap";
+string load_file;
 uint64_t sim_time = 0;
 uint64_t last_time;
 uint64_t start_time = UINT64_MAX;
@@ -68,11 +90,37 @@ uint32_t fps_frame_count = 0;
 
 #include "scancode.h"
 
+// Convert text to PS/2 make/break scancodes, for scripted keyboard input
+void type_text(vector<uint8_t> &scancode, const string &text) {
+    const string shifted   = "~!@#$%^&*()_+{}|:\"<>?";
+    const string unshifted = "`1234567890-=[]\\;',./";
+    for (char c : text) {
+        SDL_Keycode k = c;
+        bool shift = false;
+        size_t p = shifted.find(c);
+        if (isupper(c)) {
+            k = tolower(c);
+            shift = true;
+        } else if (p != string::npos) {
+            k = unshifted[p];
+            shift = true;
+        }
+        if (ps2scancodes.find(k) == ps2scancodes.end()) continue;
+        if (shift) scancode.insert(scancode.end(), ps2scancodes[SDLK_LSHIFT].first.begin(), ps2scancodes[SDLK_LSHIFT].first.end());
+        scancode.insert(scancode.end(), ps2scancodes[k].first.begin(), ps2scancodes[k].first.end());
+        scancode.insert(scancode.end(), ps2scancodes[k].second.begin(), ps2scancodes[k].second.end());
+        if (shift) scancode.insert(scancode.end(), ps2scancodes[SDLK_LSHIFT].second.begin(), ps2scancodes[SDLK_LSHIFT].second.end());
+    }
+}
+
 void step() {
     tb.clk_sys = !tb.clk_sys;
     tb.clk_vga = tb.clk_sys;
     tb.eval();
     sim_time++;
+#ifdef SIM_PROF
+    Verilated::threadContextp()->time(sim_time);    // +verilator+prof+exec+start counts in sim_time
+#endif
     if (trace_toggle) {
         trace->dump(sim_time);
     }
@@ -102,12 +150,21 @@ inline void set_cmos(uint8_t addr, uint8_t data) {
 void init_cmos() {
     if (!tb.clk_sys) step();      // make sure clk=0
 
-    int XMS_KB = 1024;     // 2MB of total memory
-    set_cmos(0x30, XMS_KB & 0xff);
-    set_cmos(0x31, (XMS_KB >> 8) & 0xff);
+    // extended memory from 1MB to 16MB in KB (0x17/0x18 is the copy in the
+    // checksummed area), anything above 16MB in 64KB blocks
+    uint32_t ram_kb = ram_bytes() >> 10;
+    uint32_t ext_kb = std::min(ram_kb, 16u << 10) - 1024;
+    uint32_t high_64k = ram_kb > (16u << 10) ? (ram_kb - (16u << 10)) >> 6 : 0;
+    set_cmos(0x17, ext_kb & 0xff);
+    set_cmos(0x18, (ext_kb >> 8) & 0xff);
+    set_cmos(0x30, ext_kb & 0xff);
+    set_cmos(0x31, (ext_kb >> 8) & 0xff);
+    set_cmos(0x34, high_64k & 0xff);
+    set_cmos(0x35, (high_64k >> 8) & 0xff);
 
     set_cmos(0x14, 0x01);  // EQUIP byte: diskette exists
-    set_cmos(0x10, 0x20);  // 1.2MB 5.25 drive
+    // drive A type follows the --fda images, otherwise a 1.2MB 5.25 drive
+    set_cmos(0x10, floppy_mounted() ? floppy_cmos_type() << 4 : 0x20);
 
     set_cmos(0x09, 0x24);  // year in BCD
     set_cmos(0x08, 0x01);  // month
@@ -128,7 +185,7 @@ void print_ide_trace() {
     if (trace_ide && tb.system->cpu_io_write_do && !cpu_io_write_do_r && 
         (tb.system->cpu_io_write_address >= 0x1f0 && tb.system->cpu_io_write_address <= 0x1f7 ||
          tb.system->cpu_io_write_address >= 0x170 && tb.system->cpu_io_write_address <= 0x177)) {
-        printf("%8lld: IDE [%04x]=%02x, EIP=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff,
+        LOG(CAT_IDE, LVL_DEBUG, "%8lld: IDE [%04x]=%02x, EIP=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff,
                 tb.system->ao486->eip);
     }
     // if (trace_ide && tb.system->cpu_io_read_do && !cpu_io_read_do_r && 
@@ -144,7 +201,7 @@ void print_vga_trace() {
     if (trace_vga && tb.system->cpu_io_write_do && !cpu_io_write_do_r && 
         // tb.system->cpu_io_write_address >= 0x3b0 && tb.system->cpu_io_write_address <= 0x3df) {
         (tb.system->cpu_io_write_address == 0x3c9 || tb.system->cpu_io_write_address == 0x3c8)) {
-        printf("%8lld: VIDEO [%04x]=%02x, EIP=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff,
+        LOG(CAT_VGA, LVL_DEBUG, "%8lld: VIDEO [%04x]=%02x, EIP=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff,
                 tb.system->ao486->eip);
     }
     // print CRTC reg writes
@@ -152,12 +209,12 @@ void print_vga_trace() {
     if (trace_vga && tb.system->cpu_io_write_do && !cpu_io_write_do_r && tb.system->cpu_io_write_address == 0x3d4 ) {
         crtc_reg = tb.system->cpu_io_write_data & 0xff;
         if ((tb.system->cpu_io_write_data & 0xff) == 6 || (tb.system->cpu_io_write_data & 0xff) == 7) {
-            printf("%8lld: CRTC [%04x]=%02x, EIP=%08x, EAX=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff, tb.system->ao486->eip, eax);    
+            LOG(CAT_VGA, LVL_DEBUG, "%8lld: CRTC [%04x]=%02x, EIP=%08x, EAX=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff, tb.system->ao486->eip, eax);    
         }
     }
     if (trace_vga && tb.system->cpu_io_write_do && !cpu_io_write_do_r && tb.system->cpu_io_write_address == 0x3d5 &&
         (crtc_reg == 6 || crtc_reg == 7)) {
-        printf("%8lld: CRTC [%04x]=%02x, EIP=%08x, EAX=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff, 
+        LOG(CAT_VGA, LVL_DEBUG, "%8lld: CRTC [%04x]=%02x, EIP=%08x, EAX=%08x\n", sim_time, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data & 0xff, 
                 tb.system->ao486->eip, eax);
     }
 
@@ -174,9 +231,11 @@ void print_vga_trace() {
 }
 
 uint8_t read_byte(uint32_t addr) {
-    uint8_t r = (tb.system->sdram->mem[addr >> 2] >> (8*(addr & 3))) & 0xff;
-    // printf("read_byte(%08x)=%02x, mem[%08x] = %08x\n", addr, r, addr >> 2, tb.system->sdram->mem[addr >> 2]);
-    return r;
+    return ram_read_byte(addr);
+}
+
+void write_byte(uint32_t addr, uint8_t data) {
+    ram_write_byte(addr, data);
 }
 
 uint16_t read_word(uint32_t addr) {
@@ -191,6 +250,11 @@ uint32_t read_dword(uint32_t addr) {
             ((uint32_t)read_byte(addr+3) << 24);
 }
 
+void write_word(uint32_t addr, uint16_t data) {
+    write_byte(addr, data & 0xff);
+    write_byte(addr+1, data >> 8);
+}
+
 string read_string(uint32_t addr) {
     string r;
     for (;;) {
@@ -201,7 +265,9 @@ string read_string(uint32_t addr) {
 }
 
 // sp points to 1st argument after format string
-void bios_printf(const string fmt, uint32_t sp, uint32_t ds, uint32_t ss) {
+string bios_printf(const string fmt, uint32_t sp, uint32_t ds, uint32_t ss) {
+    string out;
+    char numbuf[32];
     for (int i = 0; i < fmt.size(); i++) {
         uint16_t arg;
         uint16_t argu;
@@ -237,12 +303,12 @@ void bios_printf(const string fmt, uint32_t sp, uint32_t ds, uint32_t ss) {
                         arg = read_word(ss*16+sp);
                         sp+=2;
                         str = read_string(ds*16+arg);
-                        printf("%s", str.c_str());
+                        out += str;
                         break;
                     case 'c':
                         c = read_byte(ss*16+sp);
                         sp++;
-                        printf("%c", c);
+                        out += c;
                         break;
                     case 'x':
                     case 'X':
@@ -253,27 +319,30 @@ void bios_printf(const string fmt, uint32_t sp, uint32_t ds, uint32_t ss) {
                         sp+=2;
                         // For 'd', cast to int for signed printing
                         if (type == 'd')
-                            printf(fmtbuf, argu & 0x8000 ? argu - 0x10000 : argu);
+                            snprintf(numbuf, sizeof(numbuf), fmtbuf, argu & 0x8000 ? argu - 0x10000 : argu);
                         else
-                            printf(fmtbuf, argu);
+                            snprintf(numbuf, sizeof(numbuf), fmtbuf, argu);
+                        out += numbuf;
                         break;
                     }
                     default:
                         // Print unknown format as literal
-                        printf("%%%c", type);
+                        out += '%';
+                        out += type;
                 }
                 i = j;
             } else {
                 // Malformed format, print as literal
-                printf("%%");
+                out += '%';
             }
         } else
-            printf("%c", c);
+            out += c;
     }
+    return out;
 }
 
 void usage() {
-    printf("\nUsage: Vsystem [--trace] [-s T0] [-e T1] <boot0.rom> <boot1.rom> <disk.vhd>\n");
+    printf("\nUsage: Vsystem [--trace] [-s T0] [-e T1] <boot0.rom> <boot1.rom> [<disk.vhd>]\n");
     printf("  -s T0     start tracing at time T0\n");
     printf("  -e T1     stop simulation at time T1\n");
     printf("  --trace   start trace immediately\n");
@@ -281,6 +350,33 @@ void usage() {
     printf("  --ide     print ATA/IDE related operations\n");
     printf("  --post    print POST codes\n");
     printf("  --mem <addr> watch memory location\n");
+    printf("  --ram <MB>   guest RAM size, 1-256 (default 4)\n");
+    printf("  --headless   run without a display window\n");
+    printf("  --record-video <file>  record the display as a PPM sequence, repeated frames skipped\n");
+    printf("  --timebase <Hz>|auto[:X]  cycles per guest second for PIT/RTC/floppy (40M), or follow sim speed\n");
+    printf("  --rtc-sync   set the RTC from the host clock at power-on and on resume\n");
+    printf("  --fda <img>  floppy image for drive A, repeat for a disk set (WIN-F swaps)\n");
+    printf("  --vdisk <dir>  host directory as a FAT16 hard disk instead of <disk.vhd>\n");
+    printf("  --log <spec>  log levels, e.g. debug or ide=debug,frame=warn\n");
+    printf("               categories: sim ide vga kbd bios disk frame\n");
+    printf("               levels: error warn info debug\n");
+    printf("  --log-file <file>  write the log to a file instead of stdout\n");
+    printf("  --hle-disk   handle INT 13h disk reads/writes in the host\n");
+    printf("  --fast-string [N]   copy REP MOVS/STOS longer than N (64) elements in the host\n");
+    printf("  --roi-trace  trace only between the guest's region-of-interest markers\n");
+    printf("  --memstat <file.csv>  count memory accesses per 4KB page, dumped at exit or ROI end\n");
+    printf("  --irq-latency [N]  IRQ-to-handler latency per IRQ at exit or ROI end, causes of those over N cycles (2000)\n");
+    printf("  --save-at <trigger>  stop at eip=CS:IP, port=N, insn=N or time=N and save a snapshot\n");
+    printf("  --save <file>        snapshot file for --save-at (default sim.snap)\n");
+    printf("  --load <file>        resume from a snapshot\n");
+    printf("  --state-hash <trigger>  log register and memory hashes at time=N intervals or each eip=CS:IP\n");
+    printf("  --state-hash-log <file>  log file for --state-hash (default statehash.log)\n");
+    printf("  --timeline <N>       keep an in-memory checkpoint every N time units (WIN-Z rewinds)\n");
+    printf("  --timeline-mb <MB>   memory budget for --timeline (default 1024)\n");
+    printf("  --rewind <at>:<to>   with --timeline, at time <at> rewind to <to> and trace from there\n");
+    printf("  --watchdog [N]  stop on triple fault, CLI+HLT or no progress for N time units (200M)\n");
+    printf("  --bench <workload.txt>   run a scripted benchmark workload\n");
+    printf("  --bench-json <file>      write benchmark results as JSON\n");
 }
 
 void load_disk();
@@ -300,77 +396,153 @@ int main(int argc, char** argv) {
     for (int i = 1; i < argc; i++) {
         string arg(argv[i]);
         if (arg == "-s") {
-            start_time = atoi(argv[++i]);
+            start_time = strtoull(argv[++i], nullptr, 0);
         } else if (arg == "-e") {
-            stop_time = atoi(argv[++i]);
+            stop_time = strtoull(argv[++i], nullptr, 0);
         } else if (arg == "--trace") {
             set_trace(true);
         } else if (arg == "--vga") {
             trace_vga = true;
+            log_configure("vga=debug");
         } else if (arg == "--post") {
             trace_post = true;
         } else if (arg == "--ide") {
             trace_ide = true;
+            log_configure("ide=debug,disk=debug");
         } else if (arg == "--mem") {
             // Support decimal or hex (0x...) addresses
             watch_memory.insert(strtol(argv[++i], nullptr, 0) >> 2);
+        } else if (arg == "--ram") {
+            if (!ram_set_size_mb(atoi(argv[++i])))
+                return 1;
+        } else if (arg == "--record-video") {
+            if (!video_open(argv[++i]))
+                return 1;
+        } else if (arg == "--timebase") {
+            if (!timebase_configure(argv[++i]))
+                return 1;
+        } else if (arg == "--rtc-sync") {
+            rtc_sync = true;
+        } else if (arg == "--fda") {
+            if (!floppy_add_image(argv[++i]))
+                return 1;
+        } else if (arg == "--vdisk") {
+            if (!vdisk_open(argv[++i]))
+                return 1;
+        } else if (arg == "--log") {
+            if (!log_configure(argv[++i]))
+                return 1;
+        } else if (arg == "--log-file") {
+            if (!log_open(argv[++i]))
+                return 1;
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--hle-disk") {
+            hle_disk = true;
+        } else if (arg == "--fast-string") {
+            string_accel_enabled = true;
+            if (i+1 < argc && isdigit(argv[i+1][0]))
+                string_accel_threshold = atoi(argv[++i]);
+        } else if (arg == "--roi-trace") {
+            roi_trace = true;
+        } else if (arg == "--memstat") {
+            memstat_set_file(argv[++i]);
+        } else if (arg == "--irq-latency") {
+            uint32_t cycles = 0;
+            if (i+1 < argc && isdigit(argv[i+1][0]))
+                cycles = strtoul(argv[++i], nullptr, 0);
+            irqstat_set_threshold(cycles);
+        } else if (arg == "--save-at") {
+            if (!snapshot_set_trigger(argv[++i]))
+                return 1;
+        } else if (arg == "--save") {
+            save_file = argv[++i];
+        } else if (arg == "--load") {
+            load_file = argv[++i];
+        } else if (arg == "--state-hash") {
+            if (!statehash_set_trigger(argv[++i]))
+                return 1;
+        } else if (arg == "--state-hash-log") {
+            statehash_set_file(argv[++i]);
+        } else if (arg == "--timeline") {
+            timeline_set_interval(strtoull(argv[++i], nullptr, 0));
+        } else if (arg == "--timeline-mb") {
+            timeline_set_budget_mb(atoi(argv[++i]));
+        } else if (arg == "--rewind") {
+            if (!timeline_set_rewind(argv[++i]))
+                return 1;
+        } else if (arg == "--watchdog") {
+            uint64_t window = 0;
+            if (i+1 < argc && isdigit(argv[i+1][0]))
+                window = strtoull(argv[++i], nullptr, 0);
+            watchdog_set_window(window);
+        } else if (arg == "--bench") {
+            if (!bench_load(argv[++i]))
+                return 1;
+        } else if (arg == "--bench-json") {
+            bench_json = argv[++i];
+        } else if (arg[0] == '+') {
+            // +verilator+... runtime options, already taken by Verilated::commandArgs
         } else if (arg[0] == '-') {
             printf("Unknown option: %s\n", argv[i]);
             return 1;
         } else {
-            if (i+3 > argc) {
+            if (i + (vdisk_active() ? 2 : 3) > argc) {
                 usage();
                 return 1;
             }
             bios_name = argv[i];
             video_bios_name = argv[++i];
-            disk_file = argv[++i];
+            if (!vdisk_active())
+                disk_file = argv[++i];
             break;
         }
     }
 
-	if (SDL_Init(SDL_INIT_VIDEO) < 0)
-	{
-		printf("SDL init failed.\n");
-		return 1;
-	}
-
 	SDL_Window *sdl_window = NULL;
 	SDL_Renderer *sdl_renderer = NULL;
 	SDL_Texture *sdl_texture = NULL;
 
-	sdl_window = SDL_CreateWindow("z86 sim", SDL_WINDOWPOS_CENTERED,
-								  SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_SHOWN);
-	if (!sdl_window)
-	{
-		printf("Window creation failed: %s\n", SDL_GetError());
-		return 1;
-	}
-	sdl_renderer = SDL_CreateRenderer(sdl_window, -1,
-									  SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (!sdl_renderer)
-	{
-		printf("Renderer creation failed: %s\n", SDL_GetError());
-		return 1;
-	}
-
-	sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_RGBA8888,
-									SDL_TEXTUREACCESS_TARGET, H_RES, V_RES);
-	if (!sdl_texture)
-	{
-		printf("Texture creation failed: %s\n", SDL_GetError());
-		return 1;
+	if (!headless) {
+		if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		{
+			printf("SDL init failed.\n");
+			return 1;
+		}
+
+		sdl_window = SDL_CreateWindow("z86 sim", SDL_WINDOWPOS_CENTERED,
+									  SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_SHOWN);
+		if (!sdl_window)
+		{
+			printf("Window creation failed: %s\n", SDL_GetError());
+			return 1;
+		}
+		sdl_renderer = SDL_CreateRenderer(sdl_window, -1,
+										  SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+		if (!sdl_renderer)
+		{
+			printf("Renderer creation failed: %s\n", SDL_GetError());
+			return 1;
+		}
+
+		sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_RGBA8888,
+										SDL_TEXTUREACCESS_TARGET, H_RES, V_RES);
+		if (!sdl_texture)
+		{
+			printf("Texture creation failed: %s\n", SDL_GetError());
+			return 1;
+		}
+
+		SDL_UpdateTexture(sdl_texture, NULL, screenbuffer, H_RES * sizeof(Pixel));
+		SDL_RenderClear(sdl_renderer);
+		SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
+		SDL_RenderPresent(sdl_renderer);
+		SDL_StopTextInput(); // for SDL_KEYDOWN
 	}
 
-	SDL_UpdateTexture(sdl_texture, NULL, screenbuffer, H_RES * sizeof(Pixel));
-	SDL_RenderClear(sdl_renderer);
-	SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
-	SDL_RenderPresent(sdl_renderer);
-	SDL_StopTextInput(); // for SDL_KEYDOWN
-
     printf("Starting simulation\n");
 
-    tb.clock_rate = 40000000;            // for time keeping of timer, RTC and floppy
+    timebase_apply();                    // for time keeping of timer, RTC and floppy, see timebase.cpp
     tb.clock_rate_vga = 57000000;        // at least 2x VGA pixel clock (25.2Mhz and 28.3Mhz)
     if (!tb.clk_sys) step();             // make sure clk_sys is 1
     // reset whole system
@@ -393,20 +565,36 @@ int main(int argc, char** argv) {
     std::vector<uint8_t> video_bios(std::istreambuf_iterator<char>(video_bios_file), {});
     video_bios_file.close();
     load_program(0xC0000, video_bios);
+    if (hle_disk)
+        hle_disk = hle_disk_install();
 
     // set CMOS_DISKETTE (0x10) to one 1.2MB 5.25 drive.
     // and amount of extended memory
     init_cmos();
+    if (rtc_sync)
+        timebase_sync_rtc(false);
 
     // set HDD geometry and other parameters
-    init_ide("dos6.vhd");
+    init_ide(disk_file.c_str());
+
+    // insert the first floppy image
+    floppy_init();
 
-    // load disk image into drive_sd_sim.sv
-    load_disk();  
+    // load disk image into drive_sd_sim.sv, or restore everything from a snapshot
+    if (load_file.empty())
+        load_disk();  
+    else if (!snapshot_load(load_file.c_str()))
+        return 1;
 
     // now start cpu
     tb.reset = 0;
+    if (!load_file.empty()) {
+        timebase_apply();               // the snapshot brought its own clock_rate
+        if (rtc_sync)
+            timebase_sync_rtc(true);
+    }
     // tb.cpu_reset = 0;
+    bench_startup_done();
 
     bool vsync_r = 0;
     int x = 0;
@@ -420,13 +608,21 @@ int main(int argc, char** argv) {
 	uint64_t last_scancode_time;
     SDL_Keycode last_key = 0;
 
+    log_start();
+    memstat_reset();
+    irqstat_reset();
     while (sim_time < stop_time) {
         step();
 
+        if (memstat_enabled && tb.clk_sys)
+            memstat_sample();
+        if (irqstat_enabled && tb.clk_sys)
+            irqstat_sample();
+
         // watch memory locations
         if (watch_memory.size() > 0) {
             if (tb.clk_sys && tb.system->mem_write && !mem_write_r && watch_memory.find(tb.system->mem_address) != watch_memory.end()) {
-                printf("%8lld: WRITE [%08x]=%08x, BE=%1x, EIP=%08x\n", sim_time, tb.system->mem_address << 2, tb.system->mem_writedata,
+                LOG(CAT_SIM, LVL_INFO, "%8lld: WRITE [%08x]=%08x, BE=%1x, EIP=%08x\n", sim_time, tb.system->mem_address << 2, tb.system->mem_writedata,
                         tb.system->mem_byteenable, tb.system->ao486->eip);
             }
             mem_write_r = tb.system->mem_write;
@@ -438,27 +634,69 @@ int main(int argc, char** argv) {
         if (trace_vga)
             print_vga_trace();
 
+        // guest requests through the host I/O ports
+        if (sim_exit_requested())
+            break;
+        bool roi_on;
+        if (roi_trace_request(roi_on))
+            set_trace(roi_on);
+
+        if (statehash_enabled && tb.clk_sys)
+            statehash_check();
+
+        if (watchdog_enabled && tb.clk_sys && watchdog_check())
+            break;
+
+        uint64_t trace_from;
+        if (timeline_enabled && tb.clk_sys && timeline_tick(trace_from)) {
+            close_trace();
+            start_time = std::max(trace_from, sim_time + 1);
+            timebase_apply();
+            if (rtc_sync)
+                timebase_sync_rtc(true);
+        }
+
+        if (sim_time % 100000 == 0)
+            timebase_tick();
+
+        if (snapshot_armed() && snapshot_triggered()) {
+            snapshot_save(save_file.c_str());
+            break;
+        }
+
         // detect speaker output
         if (tb.speaker_out != speaker_out_r) {
             speaker_active = true;
         }
         speaker_out_r = tb.speaker_out;
 
+        // host side of INT 13h emulation
+        if (hle_disk && tb.system->cpu_io_write_do && !cpu_io_write_do_r &&
+            tb.system->cpu_io_write_address == HLE_DISK_PORT) {
+            hle_disk_service();
+        }
+
         cpu_io_write_do_r = tb.system->cpu_io_write_do;
 
+        // host side of the floppy controller's sector FIFO
+        if (floppy_mounted() && tb.clk_sys)
+            floppy_tick();
+
         // Trace int 10h (Eh) to print character
         if (tb.system->ao486->eip == 0xA58 && eip_r != 0xA58 && tb.system->ao486->pipeline_inst->cs == 0xC000) {
             uint32_t eax = tb.system->ao486->pipeline_inst->eax;
             if ((eax >> 8 & 0xFF) == 0xE) {
                 if (sim_time - last_time > 1e5) {
-                    printf("%8lld: PRINT: ", sim_time);
+                    LOG(CAT_BIOS, LVL_INFO, "%8lld: PRINT: ", sim_time);
                 }
-                printf("\033[32m%c\033[0m", eax & 0xFF);
+                LOG(CAT_BIOS, LVL_INFO, "\033[32m%c\033[0m", eax & 0xFF);
+                bench_output(eax & 0xFF);
                 last_time = sim_time;
             }
         }
         // Trace bios_printf debug messages in BIOS (boot0.rom)
-        if (tb.system->ao486->eip == 0x0907 && eip_r != 0x0907 && tb.system->ao486->pipeline_inst->cs == 0xF000) {
+        if (tb.system->ao486->eip == 0x0907 && eip_r != 0x0907 && tb.system->ao486->pipeline_inst->cs == 0xF000 &&
+            log_enabled(CAT_BIOS, LVL_INFO)) {
             uint32_t esp  = tb.system->ao486->pipeline_inst->esp;
             uint32_t ss = tb.system->ao486->pipeline_inst->ss;
             uint16_t caller = read_word(ss*16+esp);
@@ -475,21 +713,22 @@ int main(int argc, char** argv) {
                     if (action & 8) t = "DEBUG";
                     if (action & 1) t = "HALT";
                     if (action & 2) t = "SCREEN";
-                    printf("%8lld: %s from %04x:%04x, SP=%04x, SS=%04x, action=%04x, arg_fmt=%04x\n", sim_time, t, cs, caller, esp, ss, action, arg_fmt);
+                    log_printf("%8lld: %s from %04x:%04x, SP=%04x, SS=%04x, action=%04x, arg_fmt=%04x\n", sim_time, t, cs, caller, esp, ss, action, arg_fmt);
                 }
+                const char *color = "";
                 if (action & 4 || action & 8)
-                    printf("\033[33m");
+                    color = "\033[33m";
                 else if (action & 1)
-                    printf("\033[31m");
+                    color = "\033[31m";
                 else if (action & 2)
-                    printf("\033[32m");
-                bios_printf(fmt_str, esp+6, cs, ss);
-                printf("\033[0m");
+                    color = "\033[32m";
+                log_printf("%s%s\033[0m", color, bios_printf(fmt_str, esp+6, cs, ss).c_str());
                 last_time = sim_time;
             }
         }
         // Trace int 13h disk accesses
-        if (tb.system->ao486->eip == 0x85d3 && eip_r != 0x85d3 && tb.system->ao486->pipeline_inst->cs == 0xF000) {
+        if (tb.system->ao486->eip == 0x85d3 && eip_r != 0x85d3 && tb.system->ao486->pipeline_inst->cs == 0xF000 &&
+            log_enabled(CAT_DISK, LVL_DEBUG)) {
             uint32_t eax = tb.system->ao486->pipeline_inst->eax;
             uint32_t ecx = tb.system->ao486->pipeline_inst->ecx;
             uint32_t edx = tb.system->ao486->pipeline_inst->edx;
@@ -497,8 +736,8 @@ int main(int argc, char** argv) {
             int head = edx >> 8 & 0xFF;
             int sector = ecx & 0x3F;
             int count = eax & 0xFF;
-            printf("%8lld: INT 13h: AX=%04x, CX=%04x, DX=%04x", sim_time, eax & 0xFFFF, ecx & 0xFFFF, edx & 0xFFFF);
-            printf(", C/H/S = %d/%d/%d, count=%d\n", cylinder, head, sector, count);
+            log_printf("%8lld: INT 13h: AX=%04x, CX=%04x, DX=%04x, C/H/S = %d/%d/%d, count=%d\n", sim_time,
+                       eax & 0xFFFF, ecx & 0xFFFF, edx & 0xFFFF, cylinder, head, sector, count);
         }
         eip_r = tb.system->ao486->eip;
 
@@ -507,7 +746,7 @@ int main(int argc, char** argv) {
             if (tb.video_vsync && !vsync_r) {
                 x = 0; y = 0;
                 x_cnt++; y_cnt++;
-                printf("%8lld: VSYNC: pix_cnt=%d, width=%d, height=%d, speaker=%s, CS:IP=%04x:%04x\n", sim_time, pix_cnt, x_cnt, y_cnt, speaker_active ? "ON" : "OFF", 
+                LOG(CAT_FRAME, LVL_DEBUG, "%8lld: VSYNC: pix_cnt=%d, width=%d, height=%d, speaker=%s, CS:IP=%04x:%04x\n", sim_time, pix_cnt, x_cnt, y_cnt, speaker_active ? "ON" : "OFF", 
                         tb.system->ao486->pipeline_inst->cs, tb.system->ao486->eip);
 
                 // detect video resolution change
@@ -516,7 +755,7 @@ int main(int argc, char** argv) {
                      {640,480}, {640,400}, {640,200}, {640,350}, {320,200}, {320,240}};  // graphics modes
                 if ((x_cnt != resolution_x || y_cnt != resolution_y) && 
                        find(resolutions.begin(), resolutions.end(), pair<int,int>{x_cnt, y_cnt}) != resolutions.end()) {
-                    printf("New video resolution: %d x %d\n", x_cnt, y_cnt);
+                    LOG(CAT_VGA, LVL_INFO, "New video resolution: %d x %d\n", x_cnt, y_cnt);
                     resolution_x = x_cnt;
                     resolution_y = y_cnt;
                 }
@@ -535,17 +774,22 @@ int main(int argc, char** argv) {
                     uint32_t current_time = SDL_GetTicks();
                     uint32_t elapsed_ms = current_time - fps_start_time;
                     double fps = (double)fps_frame_count / (elapsed_ms / 1000.0);
-                    printf("%8lld: FPS: %.2f (frames=%d, time=%.3fs)\n", sim_time, fps, fps_frame_count, elapsed_ms / 1000.0);
+                    LOG(CAT_FRAME, LVL_INFO, "%8lld: FPS: %.2f (frames=%d, time=%.3fs)\n", sim_time, fps, fps_frame_count, elapsed_ms / 1000.0);
                 }
                 
                 // update texture once per frame (in blanking)
-                SDL_UpdateTexture(sdl_texture, NULL, screenbuffer, H_RES * sizeof(Pixel));
-                SDL_RenderClear(sdl_renderer);
-                const SDL_Rect srcRect = {0, 0, resolution_x, resolution_y};
-                SDL_RenderCopy(sdl_renderer, sdl_texture, &srcRect, NULL);
-                SDL_RenderPresent(sdl_renderer);
                 frame_count++;
-                SDL_SetWindowTitle(sdl_window, ("ao486 sim - frame " + to_string(frame_count) + (trace_toggle ? " tracing" : "") + (speaker_active ? " speaker" : "")).c_str());
+                watchdog_frame(screenbuffer, sizeof(screenbuffer));
+                if (video_recording)
+                    video_frame((const uint8_t *)screenbuffer, H_RES, resolution_x, resolution_y);
+                if (!headless) {
+                    SDL_UpdateTexture(sdl_texture, NULL, screenbuffer, H_RES * sizeof(Pixel));
+                    SDL_RenderClear(sdl_renderer);
+                    const SDL_Rect srcRect = {0, 0, resolution_x, resolution_y};
+                    SDL_RenderCopy(sdl_renderer, sdl_texture, &srcRect, NULL);
+                    SDL_RenderPresent(sdl_renderer);
+                    SDL_SetWindowTitle(sdl_window, ("ao486 sim - frame " + to_string(frame_count) + (trace_toggle ? " tracing" : "") + (speaker_active ? " speaker" : "")).c_str());
+                }
             } else if (!tb.video_blank_n) {
                 x=0;
                 if (blank_n_r) y++;
@@ -577,8 +821,16 @@ int main(int argc, char** argv) {
             set_trace(false);
         }
 
+        // advance scripted benchmark workload
+        if (bench_active() && sim_time % 1000 == 0) {
+            string keys;
+            if (!bench_poll(keys))
+                break;
+            type_text(scancode, keys);
+        }
+
         // process SDL events
-        if (sim_time % 100 == 0) {
+        if (!headless && sim_time % 100 == 0) {
             SDL_Event e;
             if (SDL_PollEvent(&e)) {
                 if (e.type == SDL_QUIT) {
@@ -598,10 +850,22 @@ int main(int argc, char** argv) {
                         } else if (e.key.keysym.sym == SDLK_s) {
                             // press WIN-S to backup disk content
                             persist_disk();
+                            floppy_flush();
+                        } else if (e.key.keysym.sym == SDLK_f) {
+                            // press WIN-F to insert the next floppy of the set
+                            floppy_swap();
+                        } else if (e.key.keysym.sym == SDLK_z) {
+                            // press WIN-Z to rewind to the previous checkpoint
+                            if (timeline_step_back()) {
+                                close_trace();
+                                timebase_apply();
+                                if (rtc_sync)
+                                    timebase_sync_rtc(true);
+                            }
                         }
                     } else {
                         last_key = e.key.keysym.sym;
-                        printf("Key pressed: %d\n", e.key.keysym.sym);
+                        LOG(CAT_KBD, LVL_DEBUG, "Key pressed: %d\n", e.key.keysym.sym);
                         if (ps2scancodes.find(e.key.keysym.sym) != ps2scancodes.end()) {
                             scancode.insert(scancode.end(), ps2scancodes[e.key.keysym.sym].first.begin(), ps2scancodes[e.key.keysym.sym].first.end());
                         }
@@ -612,7 +876,7 @@ int main(int argc, char** argv) {
                         // nothing
                     } else {
                         last_key = 0;
-                        printf("Key up: %d\n", e.key.keysym.sym);
+                        LOG(CAT_KBD, LVL_DEBUG, "Key up: %d\n", e.key.keysym.sym);
 	    				if (ps2scancodes.find(e.key.keysym.sym) != ps2scancodes.end()) {
 		    				scancode.insert(scancode.end(), ps2scancodes[e.key.keysym.sym].second.begin(), ps2scancodes[e.key.keysym.sym].second.end());
 			    		}
@@ -624,7 +888,7 @@ int main(int argc, char** argv) {
 		// send scancode to ps2_device, one scancode takes about 1ms (we'll wait 2ms)
         if (tb.clk_sys) {
             if (sim_time - last_scancode_time > 1e5  && !scancode.empty()) {
-                printf("%8lld: Sending scancode %d\n", sim_time, scancode.front());
+                LOG(CAT_KBD, LVL_DEBUG, "%8lld: Sending scancode %d\n", sim_time, scancode.front());
                 last_scancode_time = sim_time;
                 tb.kbd_data = scancode.front();
                 tb.kbd_data_valid = 1;
@@ -635,10 +899,10 @@ int main(int argc, char** argv) {
 
             if (tb.kbd_host_data & 0x100) {
                 uint8_t cmd = tb.kbd_host_data & 0xff;
-                printf("%8lld: Received keyboard command %d\n", sim_time, cmd);
+                LOG(CAT_KBD, LVL_DEBUG, "%8lld: Received keyboard command %d\n", sim_time, cmd);
                 tb.kbd_host_data_clear = 1;
                 if (cmd == 0xFF) {
-                    printf("%8lld: Keyboard reset\n", sim_time);
+                    LOG(CAT_KBD, LVL_INFO, "%8lld: Keyboard reset\n", sim_time);
                     scancode.push_back(0xFA);
                     scancode.push_back(0xAA);
                     last_scancode_time = sim_time;    // 0xFA is sent 1ms later
@@ -653,18 +917,29 @@ int main(int argc, char** argv) {
 
         }
     }
-    printf("Simulation stopped at time %lld\n", sim_time);
+    LOG(CAT_SIM, LVL_INFO, "Simulation stopped at time %lld\n", sim_time);
+    if (!bench_json.empty())
+        bench_report(bench_json.c_str());
+    string_accel_report();
+    memstat_dump();
+    irqstat_report();
+    cache_report();
+    floppy_flush();
+    statehash_close();
+    video_close();
+    LOG(CAT_SIM, LVL_INFO, "RAM: %u MB, %u KB allocated\n", ram_bytes() >> 20, ram_resident_pages() * 4);
+    log_stop();             // after the last report, so they all reach --log-file
 
     // Cleanup
     if (trace) {
         trace->close();
         delete trace;
     }
-    return 0;
+    return sim_exit_requested() ? sim_exit_code() : watchdog_exit_code();
 }
 
 void set_trace(bool toggle) {
-    printf("Tracing %s\n", toggle ? "on" : "off");
+    LOG(CAT_SIM, LVL_INFO, "Tracing %s\n", toggle ? "on" : "off");
     if (toggle) {
         if (!trace) {
             trace = new VerilatedFstC;
@@ -677,78 +952,58 @@ void set_trace(bool toggle) {
     trace_toggle = toggle;
 }
 
-int disk_size;
-// Prototypes generated by Verilator from the exports
-extern "C" {
-    void sd_write(unsigned addr, const uint8_t data);
+// the waveform cannot go back in time, so a rewind ends the current one
+void close_trace() {
+    if (trace) {
+        trace->close();
+        delete trace;
+        trace = nullptr;
+    }
+    trace_toggle = false;
 }
 
+int disk_size;
 
-static svScope sd_scope = nullptr;
-
-// DPI-C call from verilog to load disk image
+// Read the image file into disk.cpp, where driver_sd gets its sectors from
 void load_disk() {
+    if (vdisk_active()) {           // sectors are generated on demand
+        disk_size = vdisk_bytes();
+        return;
+    }
     const char *fname = disk_file.c_str();
-    unsigned blk_sz = 1024;
     struct stat st;
     printf("Loading disk image from %s.\n", fname);
-    sd_scope = svGetScopeFromName("TOP.system.driver_sd");
-    if (!sd_scope) {
-        fprintf(stderr,
-                "ERROR: scope TOP.tb.driver_sd_sim not found\n");
-        exit(1);
-    }    
-    svSetScope(sd_scope);
 
     if (stat(fname, &st) != 0) { perror(fname); return; }
-    disk_size = st.st_size;
-
-    FILE* f = fopen(fname, "rb");
-    if (!f) { perror(fname); return; }
-
-    std::vector<uint8_t> buf(blk_sz);
-    unsigned addr = 0;
-    while (addr < disk_size) {
-        size_t n = fread(buf.data(), 1,
-                         std::min<unsigned>(blk_sz, disk_size - addr), f);
-        if (!n) break;
-        for (int i = 0; i < n; i++) {
-            sd_write(addr + i, buf[i]);
-        }
-        addr += n;
-    }
-    fclose(f);
+    if (!disk_load(fname)) exit(1);
+    disk_size = disk_bytes();
     printf("Disk image loaded.\n");
 }
 
 void persist_disk() {
-    uint8_t buf[1024];
-    printf("Persisting disk image to %s.\n", disk_file.c_str());
-    svSetScope(sd_scope);
+    if (vdisk_active()) {
+        vdisk_persist();
+        return;
+    }
+    LOG(CAT_SIM, LVL_INFO, "Persisting disk image to %s.\n", disk_file.c_str());
 
     if (rename(disk_file.c_str(), (disk_file + ".bak").c_str()) != 0) {
-        printf("Failed to rename existing disk image to %s.bak\n", disk_file.c_str());
+        LOG(CAT_SIM, LVL_ERROR, "Failed to rename existing disk image to %s.bak\n", disk_file.c_str());
         return;
     }
-    printf("Existing disk image renamed to %s.bak\n", disk_file.c_str());
+    LOG(CAT_SIM, LVL_INFO, "Existing disk image renamed to %s.bak\n", disk_file.c_str());
 
     // write new disk image
     FILE* f = fopen(disk_file.c_str(), "wb");
     if (!f) {
-        printf("Failed to open disk image for writing\n");
+        LOG(CAT_SIM, LVL_ERROR, "Failed to open disk image for writing\n");
         return;
     }
-    for (int i = 0; i < disk_size; i += 1024) {
-        int n = std::min(1024, disk_size - i);
-        for (int j = 0; j < n; j++) {
-            buf[j] = tb.system->driver_sd->sd_buf[i+j];
-        }
-        if (fwrite(buf, 1, n, f) != (size_t)n) {
-            printf("Failed to write disk image\n");
-            fclose(f);
-            return;
-        }
+    if (fwrite(disk_data(), 1, disk_size, f) != (size_t)disk_size) {
+        LOG(CAT_SIM, LVL_ERROR, "Failed to write disk image\n");
+        fclose(f);
+        return;
     }
     fclose(f);
-    printf("Disk image persisted to %s\n", disk_file.c_str());
+    LOG(CAT_SIM, LVL_INFO, "Disk image persisted to %s\n", disk_file.c_str());
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+// Memory access statistics on the sdram_sim CPU port and the DMA port.
+//
+// With --memstat <file.csv>, every accepted request on the memory port is
+// counted per 4KB page and per region: read requests, dwords read (burst
+// beats), writes, and the burst length histogram. DMA transfers are
+// counted separately as well. They also show up on the memory port, as
+// ao486 forwards them there. Bus utilization is the fraction of cycles
+// with cpu_busy asserted.
+//
+// The counters live in flat arrays indexed by page, so sampling does no
+// allocation. They are dumped at exit, or at the end of the guest's
+// region of interest (which also resets them at its beginning). The dump
+// is a CSV with one row per touched page, plus a per-region summary and a
+// hot-page table in the log.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Vsystem.h"
+#include "Vsystem_system.h"
+
+#include "memstat.h"
+#include "ram.h"
+#include "log.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+
+const int HOT_PAGES = 16;
+
+enum Region { RGN_LOW, RGN_VGA, RGN_OPTION_ROM, RGN_UPPER_RAM, RGN_BIOS_ROM, RGN_EXTENDED, RGN_UNMAPPED, RGN_COUNT };
+static const char *region_names[RGN_COUNT] = {
+    "conventional 0-9FFFF", "VGA window A0000-BFFFF", "option ROM C0000-DFFFF",
+    "upper RAM E0000-EFFFF", "BIOS F0000-FFFFF", "extended RAM", "above RAM"};
+
+struct PageStat {
+    uint64_t reads, read_dwords, writes, dma_reads, dma_writes;
+};
+
+bool memstat_enabled = false;
+static std::string csv_file;
+static std::vector<PageStat> pages;             // last entry collects everything above RAM
+static PageStat regions[RGN_COUNT];
+static uint64_t burst_hist[16];
+static uint64_t cycles, busy_cycles;
+static uint64_t start_time;
+static int dumps;
+
+static Region region_of(uint32_t addr) {
+    if (addr >= ram_bytes()) return RGN_UNMAPPED;
+    if (addr < 0xA0000) return RGN_LOW;
+    if (addr < 0xC0000) return RGN_VGA;
+    if (addr < 0xE0000) return RGN_OPTION_ROM;
+    if (addr < 0xF0000) return RGN_UPPER_RAM;      // RAM, see src/common/rom_area.vh
+    if (addr < 0x100000) return RGN_BIOS_ROM;
+    return RGN_EXTENDED;
+}
+
+static uint32_t page_of(uint32_t addr) {
+    return std::min<uint32_t>(addr >> 12, pages.size() - 1);
+}
+
+void memstat_set_file(const char *filename) {
+    csv_file = filename;
+    memstat_enabled = true;
+}
+
+void memstat_reset() {
+    pages.assign((ram_bytes() >> 12) + 1, PageStat());
+    memset(regions, 0, sizeof(regions));
+    memset(burst_hist, 0, sizeof(burst_hist));
+    cycles = busy_cycles = 0;
+    start_time = sim_time;
+}
+
+// Called after every rising edge of clk_sys. The request signals then hold
+// what sdram_sim will act on at the next edge.
+void memstat_sample() {
+    cycles++;
+    if (tb.system->mem_waitrequest) {
+        busy_cycles++;
+    } else if (tb.system->mem_read || tb.system->mem_write) {
+        uint32_t addr = tb.system->mem_address << 2;
+        PageStat &p = pages[page_of(addr)];
+        PageStat &r = regions[region_of(addr)];
+        if (tb.system->mem_read) {
+            uint32_t burst = std::max(1, (int)tb.system->mem_burstcount);
+            p.reads++; r.reads++;
+            p.read_dwords += burst; r.read_dwords += burst;
+            burst_hist[burst & 15]++;
+        } else {
+            p.writes++; r.writes++;
+        }
+    }
+    if ((tb.system->dma_read || tb.system->dma_write) && !tb.system->dma_waitrequest) {
+        uint32_t addr = tb.system->dma_address;
+        PageStat &p = pages[page_of(addr)];
+        PageStat &r = regions[region_of(addr)];
+        if (tb.system->dma_read) { p.dma_reads++; r.dma_reads++; }
+        else { p.dma_writes++; r.dma_writes++; }
+    }
+}
+
+static uint64_t total(const PageStat &p) {
+    return p.reads + p.writes + p.dma_reads + p.dma_writes;
+}
+
+void memstat_dump() {
+    if (!memstat_enabled) return;
+
+    // later dumps (one per region of interest) get a numbered file name
+    std::string name = csv_file;
+    if (dumps++ > 0) {
+        size_t dot = name.find_last_of('.');
+        std::string suffix = "." + std::to_string(dumps - 1);
+        name = dot == std::string::npos ? name + suffix : name.substr(0, dot) + suffix + name.substr(dot);
+    }
+    FILE *f = fopen(name.c_str(), "w");
+    if (!f) { perror(name.c_str()); return; }
+    fprintf(f, "page,address,reads,read_dwords,writes,dma_reads,dma_writes\n");
+    uint32_t touched = 0;
+    for (uint32_t i = 0; i < pages.size(); i++) {
+        const PageStat &p = pages[i];
+        if (!total(p)) continue;
+        touched++;
+        fprintf(f, "%u,%08x,%llu,%llu,%llu,%llu,%llu\n", i, i << 12,
+                (unsigned long long)p.reads, (unsigned long long)p.read_dwords, (unsigned long long)p.writes,
+                (unsigned long long)p.dma_reads, (unsigned long long)p.dma_writes);
+    }
+    fclose(f);
+
+    LOG(CAT_SIM, LVL_INFO, "Memory statistics for sim_time %llu-%llu written to %s\n",
+        (unsigned long long)start_time, (unsigned long long)sim_time, name.c_str());
+    LOG(CAT_SIM, LVL_INFO, "  bus utilization %.2f%% (%llu of %llu cycles busy), %u pages touched (%u KB)\n",
+        cycles ? 100.0 * busy_cycles / cycles : 0.0, (unsigned long long)busy_cycles, (unsigned long long)cycles,
+        touched, touched * 4);
+    LOG(CAT_SIM, LVL_INFO, "  %-24s %12s %12s %12s %10s %10s\n", "region", "reads", "read dwords", "writes", "dma rd", "dma wr");
+    for (int i = 0; i < RGN_COUNT; i++) {
+        const PageStat &r = regions[i];
+        LOG(CAT_SIM, LVL_INFO, "  %-24s %12llu %12llu %12llu %10llu %10llu\n", region_names[i],
+            (unsigned long long)r.reads, (unsigned long long)r.read_dwords, (unsigned long long)r.writes,
+            (unsigned long long)r.dma_reads, (unsigned long long)r.dma_writes);
+    }
+    LOG(CAT_SIM, LVL_INFO, "  read bursts:");
+    for (int i = 1; i < 16; i++)
+        if (burst_hist[i])
+            LOG(CAT_SIM, LVL_INFO, " %dx%llu", i, (unsigned long long)burst_hist[i]);
+    LOG(CAT_SIM, LVL_INFO, "\n");
+
+    std::vector<uint32_t> hot;
+    for (uint32_t i = 0; i < pages.size(); i++)
+        if (total(pages[i])) hot.push_back(i);
+    size_t n = std::min(hot.size(), (size_t)HOT_PAGES);
+    std::partial_sort(hot.begin(), hot.begin() + n, hot.end(),
+                      [](uint32_t a, uint32_t b) { return total(pages[a]) > total(pages[b]); });
+    LOG(CAT_SIM, LVL_INFO, "  hot pages:\n");
+    for (size_t i = 0; i < n; i++) {
+        const PageStat &p = pages[hot[i]];
+        LOG(CAT_SIM, LVL_INFO, "    %08x %12llu accesses (%llu rd, %llu wr, %llu dma)\n", hot[i] << 12,
+            (unsigned long long)total(p), (unsigned long long)p.reads, (unsigned long long)p.writes,
+            (unsigned long long)(p.dma_reads + p.dma_writes));
+    }
+}
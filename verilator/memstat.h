@@ -0,0 +1,9 @@
+#pragma once
+
+// Memory access statistics per 4KB page, see memstat.cpp
+extern bool memstat_enabled;
+
+void memstat_set_file(const char *filename);
+void memstat_sample();
+void memstat_reset();
+void memstat_dump();
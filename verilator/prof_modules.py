@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Group a verilator_profcfunc report into per-subsystem host time.
+
+    prof_modules.py profcfunc.txt
+
+The report comes from the make profile build: --prof-cfuncs names every
+generated function after the Verilog source it came from, gprof measures
+them and verilator_profcfunc sums them up per source ("summary by design").
+This folds those sources into the parts of the machine, e.g. all of
+src/ao486/pipeline/ into "cpu pipeline", and prints the share of host time
+each part costs. What is not Verilog (Verilator runtime, harness C++) is
+listed as "runtime + harness".
+"""
+import re
+import sys
+
+GROUPS = [
+    ("cpu pipeline", "condition decode decode_commands decode_prefix decode_ready decode_regs execute "
+                     "execute_commands execute_divide execute_multiply execute_offset execute_shift fetch "
+                     "microcode microcode_commands pipeline read read_commands read_debug "
+                     "read_effective_address read_mutex read_segment write write_commands write_debug "
+                     "write_register write_stack write_string"),
+    ("cpu memory + tlb", "memory memory_read memory_write avalon_mem icache link_dcacheread link_dcachewrite "
+                         "prefetch prefetch_control prefetch_fifo tlb tlb_memtype tlb_regs"),
+    ("cpu other", "ao486 exception global_regs"),
+    ("caches", "l1_icache l1_icache_alt l1_dcache l2_cache l2_cache_alt"),
+    ("vga", "vga"),
+    ("ide", "ide"),
+    ("driver_sd", "driver_sd driver_sd_sim"),
+    ("floppy", "floppy"),
+    ("dma", "dma i8237 i8237_chan"),
+    ("ps2", "ps2 ps2_device"),
+    ("pit", "pit pit_counter"),
+    ("pic", "pic i8259"),
+    ("rtc", "rtc"),
+    ("iobus", "iobus"),
+    ("memory model", "sdram_sim"),
+    ("fifos, rams", "burst_fifo simple_fifo simple_fifo_mlab dpram simple_ram simple_mult"),
+    ("system", "system"),
+]
+
+GROUP_OF = {m: name for name, mods in GROUPS for m in mods.split()}
+
+
+def load(name):
+    """(design, percent) pairs from the "summary by design" section"""
+    rows, inside = [], False
+    with open(name) as f:
+        for line in f:
+            if "summary by design" in line.lower():
+                inside = True
+                continue
+            if not inside:
+                continue
+            if not line.strip():
+                if rows:
+                    break
+                continue
+            fields = line.split()
+            if not re.match(r"^[0-9.]+$", fields[0]):
+                continue            # column headings
+            rows.append((fields[-1], float(fields[0])))
+    return rows
+
+
+def main(argv):
+    if len(argv) != 2:
+        print(__doc__.strip())
+        return 2
+    rows = load(argv[1])
+    if not rows:
+        print("%s: no per-design summary found" % argv[1])
+        return 1
+    total = {}
+    unknown = set()
+    for design, pct in rows:
+        group = GROUP_OF.get(design)
+        if group is None:
+            group = "other"
+            unknown.add(design)
+        total[group] = total.get(group, 0.0) + pct
+    verilog = sum(total.values())
+    total["runtime + harness"] = max(0.0, 100.0 - verilog)
+
+    print("%6s  %s" % ("% time", "part"))
+    for group, pct in sorted(total.items(), key=lambda t: -t[1]):
+        print("%6.2f  %s" % (pct, group))
+    if unknown:
+        print("\nother: " + " ".join(sorted(unknown)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
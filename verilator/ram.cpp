@@ -0,0 +1,175 @@
+// Guest main memory, allocated one 4KB page at a time.
+//
+// sdram_sim.sv reads and writes RAM through the DPI functions below, so
+// the size is a run-time option (--ram <MB>) instead of a Verilog array
+// sized at build time. A page gets host memory on its first write. Until
+// then it reads as zero, the same as the zero-initialized array before.
+// So a 64MB guest costs only the pages DOS or Windows actually touch.
+//
+// The harness accesses the same pages through ram_read_byte() and
+// ram_write_byte(). Snapshots store the size and the allocated pages.
+//
+// Writes mark their page dirty, with one flag per consumer so each one sees
+// the pages written since it last looked. ram_hash() keeps one hash per page
+// and a sum over all of them, and only rehashes dirty pages, so hashing the
+// memory every few thousand cycles stays cheap (statehash.cpp). The timeline
+// (timeline.cpp) saves the dirty pages at each checkpoint.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
+
+#include "ram.h"
+
+const int PAGE_BITS = 12;
+const uint32_t PAGE_DWORDS = 1 << (PAGE_BITS - 2);
+
+static uint32_t size_bytes = 4 << 20;
+static std::vector<std::unique_ptr<uint32_t[]>> pages(size_bytes >> PAGE_BITS);
+static uint32_t resident;
+
+static std::vector<uint8_t> dirty(pages.size());
+static std::vector<uint64_t> page_hash(pages.size());
+static uint64_t hash_sum;
+
+bool ram_set_size_mb(int mb) {
+    if (mb < RAM_MIN_MB || mb > RAM_MAX_MB) {
+        printf("RAM size must be %d to %d MB\n", RAM_MIN_MB, RAM_MAX_MB);
+        return false;
+    }
+    size_bytes = (uint32_t)mb << 20;
+    pages.clear();
+    pages.resize(size_bytes >> PAGE_BITS);
+    resident = 0;
+    dirty.assign(pages.size(), 0);
+    page_hash.assign(pages.size(), 0);
+    hash_sum = 0;
+    return true;
+}
+
+uint32_t ram_bytes() {
+    return size_bytes;
+}
+
+uint32_t ram_resident_pages() {
+    return resident;
+}
+
+static uint32_t *page_for_write(uint32_t addr) {
+    std::unique_ptr<uint32_t[]> &p = pages[addr >> PAGE_BITS];
+    if (!p) {
+        p.reset(new uint32_t[PAGE_DWORDS]());
+        resident++;
+    }
+    dirty[addr >> PAGE_BITS] = 0xff;
+    return p.get();
+}
+
+uint32_t ram_pages() {
+    return pages.size();
+}
+
+bool ram_page_dirty(uint32_t page, int consumer) {
+    bool d = dirty[page] & consumer;
+    dirty[page] &= ~consumer;
+    return d;
+}
+
+const uint32_t *ram_page(uint32_t page) {
+    return pages[page].get();
+}
+
+// Replace a whole page, nullptr for an all-zero one
+void ram_set_page(uint32_t page, const uint32_t *data) {
+    if (data) {
+        memcpy(page_for_write(page << PAGE_BITS), data, PAGE_DWORDS * 4);
+    } else if (pages[page]) {
+        pages[page].reset();
+        resident--;
+        dirty[page] = 0xff;
+    }
+}
+
+// DPI, see sdram_sim.sv. Addresses are byte addresses of a dword, outside
+// of RAM reads return 0 and writes are dropped.
+extern "C" unsigned int ram_size() {
+    return size_bytes;
+}
+
+extern "C" unsigned int ram_read(unsigned int addr) {
+    if (addr >= size_bytes) return 0;
+    const std::unique_ptr<uint32_t[]> &p = pages[addr >> PAGE_BITS];
+    return p ? p[(addr >> 2) & (PAGE_DWORDS - 1)] : 0;
+}
+
+extern "C" void ram_write(unsigned int addr, unsigned int data, unsigned char be) {
+    if (addr >= size_bytes || !(be & 15)) return;
+    uint32_t mask = 0;
+    for (int i = 0; i < 4; i++)
+        if (be & (1 << i)) mask |= 0xffu << (8 * i);
+    uint32_t &d = page_for_write(addr)[(addr >> 2) & (PAGE_DWORDS - 1)];
+    d = (d & ~mask) | (data & mask);
+}
+
+// An all-zero page contributes nothing, allocated or not, so the sum only
+// depends on the memory contents.
+uint64_t ram_hash() {
+    for (uint32_t i = 0; i < pages.size(); i++) {
+        if (!ram_page_dirty(i, RAM_DIRTY_HASH)) continue;
+        const uint32_t *p = pages[i].get();
+        uint64_t h = 14695981039346656037ull ^ i, any = 0;
+        for (uint32_t j = 0; p && j < PAGE_DWORDS; j++) {
+            h = (h ^ p[j]) * 1099511628211ull;
+            any |= p[j];
+        }
+        hash_sum -= page_hash[i];
+        page_hash[i] = any ? h : 0;
+        hash_sum += page_hash[i];
+    }
+    return hash_sum;
+}
+
+uint8_t ram_read_byte(uint32_t addr) {
+    return ram_read(addr & ~3u) >> (8 * (addr & 3));
+}
+
+void ram_write_byte(uint32_t addr, uint8_t data) {
+    ram_write(addr & ~3u, (uint32_t)data << (8 * (addr & 3)), 1 << (addr & 3));
+}
+
+#ifdef SIM_SAVABLE
+
+// size in MB, number of allocated pages, then page number and contents of each
+void ram_save(VerilatedSerialize &os) {
+    uint32_t mb = size_bytes >> 20, count = resident;
+    os << mb << count;
+    for (uint32_t i = 0; i < pages.size(); i++) {
+        if (!pages[i]) continue;
+        os << i;
+        os.write(pages[i].get(), PAGE_DWORDS * 4);
+    }
+}
+
+bool ram_restore(VerilatedDeserialize &os) {
+    uint32_t mb, count;
+    os >> mb >> count;
+    if (!ram_set_size_mb(mb)) return false;
+    for (uint32_t n = 0; n < count; n++) {
+        uint32_t i;
+        os >> i;
+        if (i >= pages.size()) {
+            printf("Bad RAM page %u in snapshot\n", i);
+            return false;
+        }
+        os.read(page_for_write(i << PAGE_BITS), PAGE_DWORDS * 4);
+    }
+    return true;
+}
+
+#endif
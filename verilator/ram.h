@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// Guest main memory, see ram.cpp
+const int RAM_MIN_MB = 1;
+const int RAM_MAX_MB = 256;
+
+bool ram_set_size_mb(int mb);
+uint32_t ram_bytes();
+uint32_t ram_resident_pages();
+uint64_t ram_hash();
+
+// 4KB pages written since the consumer last asked
+const int RAM_PAGE_BYTES = 4096;
+const int RAM_DIRTY_HASH = 1;
+const int RAM_DIRTY_TIMELINE = 2;
+uint32_t ram_pages();
+bool ram_page_dirty(uint32_t page, int consumer);
+const uint32_t *ram_page(uint32_t page);
+void ram_set_page(uint32_t page, const uint32_t *data);
+
+uint8_t ram_read_byte(uint32_t addr);
+void ram_write_byte(uint32_t addr, uint8_t data);
+
+class VerilatedSerialize;
+class VerilatedDeserialize;
+void ram_save(VerilatedSerialize &os);
+bool ram_restore(VerilatedDeserialize &os);
@@ -0,0 +1,211 @@
+// Fast-forward by saving and restoring the whole simulated machine.
+//
+// A run with --save-at <trigger> --save <file> stops at the trigger and
+// writes the complete Verilator model state (CPU registers and descriptor
+// caches, pipeline, caches, PIC/PIT/RTC/VGA/IDE state), the guest RAM
+// (ram.cpp), the disk image (disk.cpp), the --vdisk overlay (vdisk.cpp) and
+// the harness state to <file>. A later run with --load <file> picks up at
+// exactly that cycle, so a boot only has to be simulated once. The RAM size
+// comes from the snapshot.
+//
+// Triggers:
+//   eip=<CS:IP>|<IP>   instruction at CS:IP (hex) reaches the write stage
+//   port=<N>           CPU writes to I/O port N
+//   insn=<N>           N instructions retired
+//   time=<N>           sim_time reaches N (same unit as -s/-e)
+//
+// Saving needs a model built with --savable (make SAVABLE=1).
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "Vsystem.h"
+#include "Vsystem_ao486.h"
+#include "Vsystem_system.h"
+#include "Vsystem_pipeline.h"
+#include "Vsystem_write.h"
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
+
+#include "snapshot.h"
+#include "ram.h"
+#include "disk.h"
+#include "vdisk.h"
+#include "floppy.h"
+#include "log.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+extern int frame_count;
+extern int resolution_x, resolution_y;
+extern int disk_size;
+extern bool hle_disk;
+
+// bump when the harness state below changes
+const uint32_t SNAPSHOT_MAGIC = 0x414f5334;     // "AOS4"
+
+enum TriggerKind { TRIGGER_NONE, TRIGGER_EIP, TRIGGER_PORT, TRIGGER_INSN, TRIGGER_TIME };
+
+static TriggerKind trigger = TRIGGER_NONE;
+static uint64_t trigger_value;
+static int trigger_cs = -1;
+static uint32_t eip_r;
+static bool io_write_r;
+static bool hit_pending;            // triggered, waiting for a point to save at
+
+bool snapshot_set_trigger(const char *spec) {
+    std::string s(spec);
+    size_t eq = s.find('=');
+    if (eq == std::string::npos) {
+        printf("Bad trigger: %s\n", spec);
+        return false;
+    }
+    std::string kind = s.substr(0, eq), value = s.substr(eq+1);
+    if (kind == "eip") {
+        size_t colon = value.find(':');
+        if (colon != std::string::npos) {
+            trigger_cs = strtol(value.substr(0, colon).c_str(), nullptr, 16);
+            value = value.substr(colon+1);
+        }
+        trigger_value = strtoull(value.c_str(), nullptr, 16);
+        trigger = TRIGGER_EIP;
+    } else if (kind == "port") {
+        trigger_value = strtoull(value.c_str(), nullptr, 0);
+        trigger = TRIGGER_PORT;
+    } else if (kind == "insn") {
+        trigger_value = strtoull(value.c_str(), nullptr, 0);
+        trigger = TRIGGER_INSN;
+    } else if (kind == "time") {
+        trigger_value = strtoull(value.c_str(), nullptr, 0);
+        trigger = TRIGGER_TIME;
+    } else {
+        printf("Bad trigger: %s\n", spec);
+        return false;
+    }
+    return true;
+}
+
+bool snapshot_armed() {
+    return trigger != TRIGGER_NONE;
+}
+
+// Called once per step()
+bool snapshot_triggered() {
+    bool hit = false;
+    switch (trigger) {
+    case TRIGGER_NONE:
+        break;
+    case TRIGGER_EIP: {
+        uint32_t eip = tb.system->ao486->eip;
+        hit = eip == trigger_value && eip_r != trigger_value &&
+              (trigger_cs < 0 || tb.system->ao486->pipeline_inst->cs == trigger_cs);
+        eip_r = eip;
+        break;
+    }
+    case TRIGGER_PORT:
+        hit = tb.system->cpu_io_write_do && !io_write_r &&
+              tb.system->cpu_io_write_address == trigger_value;
+        io_write_r = tb.system->cpu_io_write_do;
+        break;
+    case TRIGGER_INSN:
+        hit = tb.system->ao486->pipeline_inst->write_inst->retired >= trigger_value;
+        break;
+    case TRIGGER_TIME:
+        hit = sim_time >= trigger_value;
+        break;
+    }
+    // save on a settled rising edge, so the restored run continues with the
+    // falling one, and with no floppy transfer in flight: the backend's state
+    // is not in the snapshot (floppy.cpp)
+    hit_pending |= hit;
+    if (hit_pending && tb.clk_sys && floppy_idle()) {
+        trigger = TRIGGER_NONE;
+        hit_pending = false;
+        return true;
+    }
+    return false;
+}
+
+#ifdef SIM_SAVABLE
+
+// Model and harness state, everything but RAM, the disk image and the disk
+// overlay. Also used for the timeline checkpoints (timeline.cpp).
+void snapshot_save_state(VerilatedSerialize &os) {
+    // the serializers take non-const references of fixed-width types
+    uint32_t harness[] = {(uint32_t)frame_count, (uint32_t)resolution_x, (uint32_t)resolution_y,
+                          (uint32_t)disk_size, hle_disk};
+    os << sim_time;
+    for (uint32_t &v : harness) os << v;
+    os << tb;
+}
+
+void snapshot_restore_state(VerilatedDeserialize &os) {
+    uint32_t harness[5];
+    os >> sim_time;
+    for (uint32_t &v : harness) os >> v;
+    os >> tb;
+    frame_count = harness[0];
+    resolution_x = harness[1];
+    resolution_y = harness[2];
+    disk_size = harness[3];
+    hle_disk = harness[4];      // the BIOS in the snapshot may be patched for INT 13h emulation
+}
+
+bool snapshot_save(const char *filename) {
+    VerilatedSave os;
+    os.open(filename);
+    if (!os.isOpen()) {
+        LOG(CAT_SIM, LVL_ERROR, "Cannot write snapshot %s\n", filename);
+        return false;
+    }
+    uint32_t magic = SNAPSHOT_MAGIC;
+    os << magic;
+    snapshot_save_state(os);
+    ram_save(os);
+    disk_save(os);
+    vdisk_save(os);
+    os.close();
+    LOG(CAT_SIM, LVL_INFO, "%8lld: Snapshot saved to %s (CS:EIP=%04x:%08x)\n", sim_time, filename,
+           tb.system->ao486->pipeline_inst->cs, tb.system->ao486->eip);
+    return true;
+}
+
+bool snapshot_load(const char *filename) {
+    VerilatedRestore os;
+    os.open(filename);
+    if (!os.isOpen()) {
+        printf("Cannot open snapshot %s\n", filename);
+        return false;
+    }
+    uint32_t magic;
+    os >> magic;
+    if (magic != SNAPSHOT_MAGIC) {
+        printf("%s is not a snapshot of this simulator version\n", filename);
+        return false;
+    }
+    snapshot_restore_state(os);
+    bool ram_ok = ram_restore(os) && disk_restore(os) && vdisk_restore(os);
+    os.close();
+    if (!ram_ok)
+        return false;
+    printf("%8lld: Snapshot loaded from %s (CS:EIP=%04x:%08x)\n", sim_time, filename,
+           tb.system->ao486->pipeline_inst->cs, tb.system->ao486->eip);
+    return true;
+}
+
+#else
+
+bool snapshot_save(const char *filename) {
+    LOG(CAT_SIM, LVL_ERROR, "Snapshots need a model built with 'make SAVABLE=1'\n");
+    return false;
+}
+
+bool snapshot_load(const char *filename) {
+    return snapshot_save(filename);
+}
+
+#endif
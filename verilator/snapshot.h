@@ -0,0 +1,13 @@
+#pragma once
+
+// Fast-forward through saved model state, see snapshot.cpp
+bool snapshot_set_trigger(const char *spec);
+bool snapshot_armed();
+bool snapshot_triggered();
+bool snapshot_save(const char *filename);
+bool snapshot_load(const char *filename);
+
+class VerilatedSerialize;
+class VerilatedDeserialize;
+void snapshot_save_state(VerilatedSerialize &os);
+void snapshot_restore_state(VerilatedDeserialize &os);
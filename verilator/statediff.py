@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Find the first interval where two --state-hash logs diverge.
+
+    statediff.py a.log b.log [--rerun <Vsystem command line>]
+
+Lines are compared in order on everything but sim_time, so logs taken with an
+eip= trigger still line up when one build is faster than the other. The
+interval reported is from the last matching line to the first differing one,
+in the sim_time of the first log. With --rerun the given command is started
+again with -s/-e set to that interval, which writes waveform.fst for just the
+cycles that matter, e.g.
+
+    statediff.py good.log bad.log --rerun obj_dir/Vsystem --headless boot0.rom boot1.rom dos6.vhd
+"""
+import subprocess
+import sys
+
+FIELDS = ["sim_time", "retired", "cs:eip", "regs", "mem"]
+
+
+def load(name):
+    with open(name) as f:
+        return [l.split() for l in f if l.strip() and not l.startswith("#")]
+
+
+def main(argv):
+    rerun = []
+    if "--rerun" in argv:
+        i = argv.index("--rerun")
+        argv, rerun = argv[:i], argv[i + 1:]
+    if len(argv) != 3:
+        print(__doc__.strip())
+        return 2
+    a, b = load(argv[1]), load(argv[2])
+
+    for n, (ra, rb) in enumerate(zip(a, b)):
+        if ra[1:] != rb[1:]:
+            break
+    else:
+        if len(a) == len(b):
+            print("%d records, no difference" % len(a))
+            return 0
+        n = min(len(a), len(b))
+        print("identical for %d records, then %s ends" % (n, argv[1] if len(a) < len(b) else argv[2]))
+        if n == len(a):
+            return 1
+
+    start = int(a[n - 1][0]) if n > 0 else 0
+    end = int(a[n][0])
+    print("first difference in record %d, sim_time %d to %d" % (n, start, end))
+    if n < len(b):
+        diff = [f for f, x, y in zip(FIELDS[1:], a[n][1:], b[n][1:]) if x != y]
+        print("  differs: %s" % ", ".join(diff))
+        print("  %s: %s" % (argv[1], " ".join(a[n])))
+        print("  %s: %s" % (argv[2], " ".join(b[n])))
+
+    if rerun:
+        cmd = rerun[:1] + ["-s", str(start), "-e", str(end)] + rerun[1:]
+        print("rerunning: %s" % " ".join(cmd))
+        subprocess.call(cmd)
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,121 @@
+// Periodic state hashes for finding where two builds start to diverge.
+//
+// --state-hash <trigger> writes one line per trigger hit to statehash.log
+// (--state-hash-log <file> to change):
+//   <sim_time> <retired> <CS:EIP> <register hash> <memory hash>
+// The register hash covers the GPRs, EFLAGS, segment selectors, LDTR/TR,
+// CR0/CR2/CR3 and the GDT/IDT bases. The memory hash comes from ram_hash(),
+// which only rehashes pages written since the previous line.
+//
+// Triggers:
+//   time=<N>           every N time units (same unit as -s/-e)
+//   eip=<CS:IP>|<IP>   every time the instruction at CS:IP (hex) is reached
+//
+// statediff.py compares two logs, reports the first interval whose line
+// differs and can rerun the simulation with tracing just for that interval.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "Vsystem.h"
+#include "Vsystem_ao486.h"
+#include "Vsystem_system.h"
+#include "Vsystem_pipeline.h"
+#include "Vsystem_write.h"
+
+#include "statehash.h"
+#include "ram.h"
+#include "log.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+
+bool statehash_enabled;
+
+static std::string filename = "statehash.log";
+static FILE *out;
+
+static bool every_eip;
+static uint64_t interval, next_time;
+static uint32_t trigger_eip;
+static int trigger_cs = -1;
+static uint32_t eip_r;
+
+bool statehash_set_trigger(const char *spec) {
+    std::string s(spec);
+    size_t eq = s.find('=');
+    std::string kind = s.substr(0, eq), value = eq == std::string::npos ? "" : s.substr(eq+1);
+    if (kind == "time" && strtoull(value.c_str(), nullptr, 0) > 0) {
+        interval = strtoull(value.c_str(), nullptr, 0);
+        next_time = interval;
+    } else if (kind == "eip" && !value.empty()) {
+        size_t colon = value.find(':');
+        if (colon != std::string::npos) {
+            trigger_cs = strtol(value.substr(0, colon).c_str(), nullptr, 16);
+            value = value.substr(colon+1);
+        }
+        trigger_eip = strtoul(value.c_str(), nullptr, 16);
+        every_eip = true;
+    } else {
+        printf("Bad state hash trigger: %s\n", spec);
+        return false;
+    }
+    statehash_enabled = true;
+    return true;
+}
+
+void statehash_set_file(const char *name) {
+    filename = name;
+}
+
+static uint64_t hash_registers() {
+    Vsystem_pipeline *p = tb.system->ao486->pipeline_inst;
+    uint32_t regs[] = {
+        p->eax, p->ebx, p->ecx, p->edx, p->esi, p->edi, p->ebp, p->esp,
+        tb.system->ao486->eip, p->eflags,
+        p->cs, p->ds, p->es, p->fs, p->gs, p->ss, p->ldtr, p->tr,
+        p->cr0, p->cr2, p->cr3, p->gdtr_base, p->idtr_base,
+    };
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t v : regs)
+        h = (h ^ v) * 1099511628211ull;
+    return h;
+}
+
+static void record() {
+    if (!out) {
+        out = fopen(filename.c_str(), "w");
+        if (!out) {
+            LOG(CAT_SIM, LVL_ERROR, "Cannot write %s\n", filename.c_str());
+            statehash_enabled = false;
+            return;
+        }
+        setvbuf(out, nullptr, _IOLBF, 0);       // keep what we have if the run dies
+        fprintf(out, "# sim_time retired cs:eip regs mem\n");
+    }
+    Vsystem_pipeline *p = tb.system->ao486->pipeline_inst;
+    fprintf(out, "%lld %llu %04x:%08x %016llx %016llx\n", sim_time,
+            (unsigned long long)p->write_inst->retired, p->cs, tb.system->ao486->eip,
+            (unsigned long long)hash_registers(), (unsigned long long)ram_hash());
+}
+
+// Called on every rising clock edge
+void statehash_check() {
+    if (every_eip) {
+        uint32_t eip = tb.system->ao486->eip;
+        if (eip == trigger_eip && eip_r != trigger_eip &&
+            (trigger_cs < 0 || tb.system->ao486->pipeline_inst->cs == trigger_cs))
+            record();
+        eip_r = eip;
+    } else if (sim_time >= next_time || next_time - sim_time > interval) {     // or after a rewind
+        record();
+        next_time = (sim_time / interval + 1) * interval;
+    }
+}
+
+void statehash_close() {
+    if (out) fclose(out);
+    out = nullptr;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Periodic hashes of the architectural and memory state, see statehash.cpp
+extern bool statehash_enabled;
+
+bool statehash_set_trigger(const char *spec);
+void statehash_set_file(const char *filename);
+void statehash_check();
+void statehash_close();
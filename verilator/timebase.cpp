@@ -0,0 +1,148 @@
+// Guest timebase, set independently of the CPU clock.
+//
+// tb.clock_rate tells the PIT, RTC and floppy controller how many clk_sys
+// cycles make a second. At the default of 40M guest time is exact for a
+// 40MHz CPU, so with the simulator running at a tiny fraction of that, the
+// guest's clock crawls and every guest second still pays for 18.2 timer
+// interrupts.
+//   --timebase <Hz>         cycles per guest second. Larger values mean
+//                           fewer timer interrupts per cycle, for throughput
+//                           runs. Smaller ones make guest time pass faster,
+//                           so delays and timeouts end in fewer cycles.
+//   --timebase auto[:<X>]   measure the simulation speed every host second
+//                           and set the timebase so guest time runs X times
+//                           as fast as host time (default 1, real time).
+//   --rtc-sync              take the RTC date and time from the host at
+//                           power-on, and set the RTC and the BIOS tick count
+//                           again after --load or a timeline rewind.
+// The PIT needs at least 2386362 cycles per second (two per 1.193MHz tick).
+// pit.v and rtc.v add their tick rate to a 28-bit accumulator and compare it
+// with clock_rate, so clock_rate must leave room for the PIT's 2386362 below
+// 2^28 or the sum wraps and ticks are lost. Values are clamped to that
+// range. auto and changes at run time make runs non-deterministic.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+
+#include "Vsystem.h"
+
+#include "timebase.h"
+#include "ram.h"
+#include "cache.h"
+#include "log.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+extern void step();
+
+bool rtc_sync;
+
+static const uint32_t TIMEBASE_MIN = 2386362;
+static const uint32_t TIMEBASE_MAX = (1 << 28) - TIMEBASE_MIN;   // headroom for pit.v's accumulator
+static const uint32_t MGMT_RTC = 0xF400;
+
+static uint32_t timebase = 40000000;
+static bool automatic;
+static double speedup = 1.0;            // guest seconds per host second in auto mode
+static bool clamp_warned;
+
+static std::chrono::steady_clock::time_point measure_t0;
+static uint64_t measure_sim0;
+
+bool timebase_configure(const char *spec) {
+    if (!strncmp(spec, "auto", 4) && (spec[4] == 0 || spec[4] == ':')) {
+        automatic = true;
+        if (spec[4] == ':') speedup = atof(spec + 5);
+        if (speedup <= 0) {
+            printf("Bad timebase speedup: %s\n", spec);
+            return false;
+        }
+        return true;
+    }
+    char *end;
+    uint64_t hz = strtoull(spec, &end, 0);
+    if (*end || hz == 0) {
+        printf("Bad timebase: %s, expected cycles per second or auto[:X]\n", spec);
+        return false;
+    }
+    timebase_set(std::min<uint64_t>(hz, TIMEBASE_MAX));
+    return true;
+}
+
+void timebase_set(uint32_t hz) {
+    hz = std::max(TIMEBASE_MIN, std::min(TIMEBASE_MAX, hz));
+    if (hz != timebase)
+        LOG(CAT_SIM, LVL_INFO, "%8lld: Timebase %u cycles per guest second\n", sim_time, hz);
+    timebase = hz;
+    tb.clock_rate = hz;
+}
+
+// (Re)load the timebase into the model, e.g. after a snapshot brought its own
+void timebase_apply() {
+    tb.clock_rate = timebase;
+    measure_t0 = std::chrono::steady_clock::now();
+    measure_sim0 = sim_time;
+}
+
+// Called from the main loop every 100K time units
+void timebase_tick() {
+    if (!automatic) return;
+    auto now = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(now - measure_t0).count();
+    if (sec < 1.0) return;
+    if (sim_time > measure_sim0) {
+        double cycles_per_sec = (sim_time - measure_sim0) / 2 / sec;   // two time units per cycle
+        if (cycles_per_sec / speedup < TIMEBASE_MIN && !clamp_warned) {
+            LOG(CAT_SIM, LVL_WARN, "%8lld: Simulation too slow for auto timebase (%.0f cycles per second), "
+                "held at the minimum %u; guest time runs behind\n", sim_time, cycles_per_sec, TIMEBASE_MIN);
+            clamp_warned = true;
+        }
+        timebase_set((uint32_t)std::min<double>(cycles_per_sec / speedup, TIMEBASE_MAX));
+    }
+    measure_t0 = now;
+    measure_sim0 = sim_time;
+}
+
+static uint8_t bcd(int v) {
+    return (v / 10) << 4 | v % 10;
+}
+
+static void set_rtc(uint8_t addr, uint8_t data) {
+    tb.mgmt_write = 1;
+    tb.mgmt_address = MGMT_RTC + addr;
+    tb.mgmt_writedata = data;
+    step(); step();
+    tb.mgmt_write = 0;
+}
+
+// Host local time into the RTC (BCD, as the BIOS sets it up). With `ticks`
+// the BIOS tick count in the BDA follows too, which is what DOS keeps its
+// time of day in once booted.
+void timebase_sync_rtc(bool ticks) {
+    time_t t = time(nullptr);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    if (!tb.clk_sys) step();
+    set_rtc(0x00, bcd(tm.tm_sec));
+    set_rtc(0x02, bcd(tm.tm_min));
+    set_rtc(0x04, bcd(tm.tm_hour));
+    set_rtc(0x06, tm.tm_wday + 1);
+    set_rtc(0x07, bcd(tm.tm_mday));
+    set_rtc(0x08, bcd(tm.tm_mon + 1));
+    set_rtc(0x09, bcd(tm.tm_year % 100));
+    set_rtc(0x32, bcd(19 + tm.tm_year / 100));
+    if (ticks) {
+        uint32_t count = (tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec) * 1193180ull / 65536;
+        for (int i = 0; i < 4; i++)
+            ram_write_byte(0x46C + i, count >> (8 * i));
+        ram_write_byte(0x470, 0);           // midnight flag
+        flush_caches();
+    }
+    LOG(CAT_SIM, LVL_INFO, "%8lld: RTC set to %04d-%02d-%02d %02d:%02d:%02d\n", sim_time, tm.tm_year + 1900,
+        tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
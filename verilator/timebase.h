@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+// Guest timebase for the PIT, RTC and floppy, see timebase.cpp
+extern bool rtc_sync;
+
+bool timebase_configure(const char *spec);
+void timebase_set(uint32_t hz);
+void timebase_apply();
+void timebase_tick();
+void timebase_sync_rtc(bool ticks);
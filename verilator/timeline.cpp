@@ -0,0 +1,320 @@
+// Checkpoint timeline for rewinding a running simulation.
+//
+// --timeline N keeps a checkpoint every N time units (same unit as -s/-e).
+// The first one is complete: the serialized model and harness state (what a
+// snapshot holds, see snapshot.cpp) with the --vdisk overlay, every allocated
+// RAM page and every non-zero sector of the disk image. The later ones are
+// deltas against their predecessor: the RAM pages and disk sectors written in
+// between (ram.cpp and disk.cpp track them) and the 4KB blocks of the
+// serialized model that changed. Everything stays in host memory, and all of
+// it, including the copy of the newest serialized model kept for comparing,
+// counts against --timeline-mb (default 1024). Past that, the oldest delta is
+// folded into the first checkpoint.
+//
+// Rewinding to time T restores the newest checkpoint at or before T and
+// drops the later ones, then the main loop simulates forward from there:
+//   --rewind <at>:<to>   when sim_time reaches <at>, go back to <to> and
+//                        write waveform.fst from <to> on
+//   WIN-Z                go back to the checkpoint before the newest one
+// Like snapshots this needs a model built with SAVABLE=1. A checkpoint waits
+// until the floppy backend (floppy.cpp) has no transfer in flight, so all of
+// its state is in the model; writes to the floppy image itself are not undone.
+// Keystrokes queued in the harness are not checkpointed.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
+
+#include "timeline.h"
+#include "snapshot.h"
+#include "ram.h"
+#include "disk.h"
+#include "vdisk.h"
+#include "floppy.h"
+#include "log.h"
+
+extern uint64_t sim_time;
+
+bool timeline_enabled;
+
+static uint64_t interval, next_time;
+static size_t budget = (size_t)1024 << 20;
+static uint64_t rewind_at = UINT64_MAX, rewind_to;
+
+void timeline_set_interval(uint64_t n) {
+    timeline_enabled = n > 0;
+    interval = n;
+}
+
+void timeline_set_budget_mb(uint32_t mb) {
+    budget = (size_t)mb << 20;
+}
+
+bool timeline_set_rewind(const char *spec) {
+    char *end;
+    rewind_at = strtoull(spec, &end, 0);
+    if (*end != ':' || (rewind_to = strtoull(end + 1, &end, 0), *end) || rewind_to > rewind_at) {
+        printf("Bad rewind: %s, expected <at>:<to> with to <= at\n", spec);
+        return false;
+    }
+    return true;
+}
+
+#ifdef SIM_SAVABLE
+
+static const size_t BLOCK = 4096;
+
+// block number to contents; an empty RAM page is an all-zero one, and so is
+// a disk sector missing from every checkpoint up to the one restored
+typedef std::map<uint32_t, std::vector<uint8_t>> Blocks;
+
+struct Checkpoint {
+    uint64_t time;
+    Blocks ram, disk, model;
+    size_t model_size;          // bytes of the serialized model
+    size_t bytes;               // memory held by this checkpoint
+};
+
+static std::deque<Checkpoint> checkpoints;
+static std::vector<uint8_t> model_now;     // serialized model of the newest checkpoint
+static size_t stored;
+
+// VerilatedSave/VerilatedRestore to and from a byte vector
+class MemorySave : public VerilatedSerialize {
+    std::vector<uint8_t> &m_out;
+public:
+    MemorySave(std::vector<uint8_t> &out) : m_out(out) {
+        m_out.clear();
+        m_isOpen = true;
+        m_cp = m_bufp;
+        header();
+    }
+    ~MemorySave() override { close(); }
+    void close() override {
+        if (!m_isOpen) return;
+        trailer();
+        flush();
+        m_isOpen = false;
+    }
+    void flush() override {
+        m_out.insert(m_out.end(), m_bufp, m_cp);
+        m_cp = m_bufp;
+    }
+};
+
+class MemoryRestore : public VerilatedDeserialize {
+    const std::vector<uint8_t> &m_in;
+    size_t m_pos = 0;
+public:
+    MemoryRestore(const std::vector<uint8_t> &in) : m_in(in) {
+        m_isOpen = true;
+        m_cp = m_endp = m_bufp;
+        header();
+    }
+    ~MemoryRestore() override { close(); }
+    void close() override {
+        if (!m_isOpen) return;
+        trailer();
+        flush();
+        m_isOpen = false;
+    }
+    void fill() override {
+        size_t left = m_endp - m_cp;
+        memmove(m_bufp, m_cp, left);
+        m_cp = m_bufp;
+        m_endp = m_bufp + left;
+        size_t n = std::min(bufferSize() - left, m_in.size() - m_pos);
+        memcpy(m_endp, m_in.data() + m_pos, n);
+        m_pos += n;
+        m_endp += n;
+    }
+};
+
+static size_t blocks_bytes(const Blocks &b) {
+    size_t n = 0;
+    for (auto &e : b) n += e.second.size() + 64;    // rough map node overhead
+    return n;
+}
+
+// Fold the oldest delta into the first checkpoint
+static void fold() {
+    Checkpoint &base = checkpoints[0], &d = checkpoints[1];
+    for (auto &e : d.ram) {
+        if (e.second.empty()) base.ram.erase(e.first);
+        else base.ram[e.first] = std::move(e.second);
+    }
+    for (auto &e : d.disk)
+        base.disk[e.first] = std::move(e.second);
+    for (auto &e : d.model)
+        base.model[e.first] = std::move(e.second);
+    base.model.erase(base.model.lower_bound((d.model_size + BLOCK - 1) / BLOCK), base.model.end());
+    base.time = d.time;
+    base.model_size = d.model_size;
+    stored -= base.bytes + d.bytes;
+    base.bytes = blocks_bytes(base.ram) + blocks_bytes(base.disk) + blocks_bytes(base.model);
+    stored += base.bytes;
+    checkpoints.erase(checkpoints.begin() + 1);
+}
+
+static bool is_zero(const uint8_t *p, size_t n) {
+    return p[0] == 0 && !memcmp(p, p + 1, n - 1);
+}
+
+// Returns false, and takes none, while the floppy backend is busy
+static bool record() {
+    if (!floppy_idle()) return false;
+    bool first = checkpoints.empty();
+    Checkpoint c = {sim_time};
+
+    for (uint32_t i = 0; i < ram_pages(); i++) {
+        if (!ram_page_dirty(i, RAM_DIRTY_TIMELINE) && !first) continue;
+        const uint8_t *p = (const uint8_t *)ram_page(i);
+        if (p) c.ram[i].assign(p, p + BLOCK);
+        else if (!first) c.ram[i];
+    }
+
+    for (uint32_t i = 0; i < disk_sectors(); i++) {
+        if (!disk_sector_dirty(i) && !first) continue;
+        const uint8_t *p = disk_sector(i);
+        if (!first || !is_zero(p, DISK_SECTOR_BYTES)) c.disk[i].assign(p, p + DISK_SECTOR_BYTES);
+    }
+
+    std::vector<uint8_t> blob;
+    {
+        MemorySave os(blob);
+        snapshot_save_state(os);
+        vdisk_save(os);
+    }
+    for (size_t off = 0; off < blob.size(); off += BLOCK) {
+        size_t n = std::min(BLOCK, blob.size() - off);
+        if (!first && off + n <= model_now.size() && !memcmp(&blob[off], &model_now[off], n))
+            continue;
+        c.model[off / BLOCK].assign(blob.begin() + off, blob.begin() + off + n);
+    }
+    c.model_size = blob.size();
+    c.bytes = blocks_bytes(c.ram) + blocks_bytes(c.disk) + blocks_bytes(c.model);
+    stored += blob.size() - model_now.size();
+    model_now.swap(blob);
+
+    LOG(CAT_SIM, LVL_DEBUG, "%8lld: Timeline checkpoint %zu, %zu RAM pages, %zu disk sectors, %zu model blocks\n",
+        sim_time, checkpoints.size(), c.ram.size(), c.disk.size(), c.model.size());
+    stored += c.bytes;
+    checkpoints.push_back(std::move(c));
+    while (stored > budget && checkpoints.size() > 2)
+        fold();
+    return true;
+}
+
+bool timeline_rewind(uint64_t time) {
+    if (checkpoints.empty() || time < checkpoints[0].time) {
+        LOG(CAT_SIM, LVL_WARN, "%8lld: No checkpoint at or before %llu to rewind to\n", sim_time,
+            (unsigned long long)time);
+        return false;
+    }
+    size_t k = checkpoints.size() - 1;
+    while (checkpoints[k].time > time) k--;
+
+    // pages written after checkpoint k get their contents as of k
+    std::set<uint32_t> pages;
+    for (size_t j = k + 1; j < checkpoints.size(); j++)
+        for (auto &e : checkpoints[j].ram) pages.insert(e.first);
+    for (uint32_t i = 0; i < ram_pages(); i++)
+        if (ram_page_dirty(i, RAM_DIRTY_TIMELINE)) pages.insert(i);
+    for (uint32_t page : pages) {
+        const std::vector<uint8_t> *data = nullptr;
+        for (size_t j = k + 1; j-- > 0 && !data; ) {
+            auto it = checkpoints[j].ram.find(page);
+            if (it != checkpoints[j].ram.end()) data = &it->second;
+        }
+        ram_set_page(page, data && !data->empty() ? (const uint32_t *)data->data() : nullptr);
+        ram_page_dirty(page, RAM_DIRTY_TIMELINE);
+    }
+
+    // and so do disk sectors
+    std::set<uint32_t> sectors;
+    for (size_t j = k + 1; j < checkpoints.size(); j++)
+        for (auto &e : checkpoints[j].disk) sectors.insert(e.first);
+    for (uint32_t i = 0; i < disk_sectors(); i++)
+        if (disk_sector_dirty(i)) sectors.insert(i);
+    static const uint8_t zero[DISK_SECTOR_BYTES] = {};
+    for (uint32_t sector : sectors) {
+        const uint8_t *data = zero;
+        for (size_t j = k + 1; j-- > 0 && data == zero; ) {
+            auto it = checkpoints[j].disk.find(sector);
+            if (it != checkpoints[j].disk.end()) data = it->second.data();
+        }
+        disk_set_sector(sector, data);
+        disk_sector_dirty(sector);
+    }
+
+    std::vector<uint8_t> blob;
+    for (size_t j = 0; j <= k; j++) {
+        blob.resize(checkpoints[j].model_size);
+        for (auto &e : checkpoints[j].model)
+            memcpy(&blob[e.first * BLOCK], e.second.data(), e.second.size());
+    }
+    {
+        MemoryRestore os(blob);
+        snapshot_restore_state(os);
+        vdisk_restore(os);
+    }
+    stored += blob.size() - model_now.size();
+    model_now.swap(blob);
+    floppy_rewound();
+
+    for (size_t j = k + 1; j < checkpoints.size(); j++)
+        stored -= checkpoints[j].bytes;
+    checkpoints.erase(checkpoints.begin() + k + 1, checkpoints.end());
+    next_time = sim_time + interval;
+    LOG(CAT_SIM, LVL_INFO, "%8lld: Rewound to checkpoint %zu for %llu\n", sim_time, k, (unsigned long long)time);
+    return true;
+}
+
+bool timeline_step_back() {
+    if (checkpoints.empty()) return false;
+    size_t n = checkpoints.size();
+    return timeline_rewind(checkpoints[n > 1 ? n - 2 : 0].time);
+}
+
+// Called on every rising clock edge, so checkpoints are taken on a settled
+// edge like snapshots. Returns true after a --rewind, with the time tracing
+// should start at.
+bool timeline_tick(uint64_t &trace_from) {
+    if (sim_time >= rewind_at) {
+        rewind_at = UINT64_MAX;
+        if (timeline_rewind(rewind_to)) {
+            trace_from = rewind_to;
+            return true;
+        }
+    }
+    if (sim_time >= next_time && record())
+        next_time = sim_time + interval;
+    return false;
+}
+
+#else
+
+bool timeline_tick(uint64_t &trace_from) {
+    LOG(CAT_SIM, LVL_ERROR, "The timeline needs a model built with 'make SAVABLE=1'\n");
+    timeline_enabled = false;
+    return false;
+}
+
+bool timeline_rewind(uint64_t time) {
+    return false;
+}
+
+bool timeline_step_back() {
+    return false;
+}
+
+#endif
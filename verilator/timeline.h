@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// In-memory checkpoints for rewinding a running simulation, see timeline.cpp
+extern bool timeline_enabled;
+
+void timeline_set_interval(uint64_t interval);
+void timeline_set_budget_mb(uint32_t mb);
+bool timeline_set_rewind(const char *spec);
+bool timeline_tick(uint64_t &trace_from);
+bool timeline_rewind(uint64_t time);
+bool timeline_step_back();
@@ -0,0 +1,450 @@
+// Host directory presented as a FAT16 hard disk (--vdisk <dir>).
+//
+// The directory tree is scanned once for names and sizes, and every file and
+// subdirectory gets a contiguous cluster run. Nothing else is prepared: the
+// MBR, boot sector, FAT and directory sectors are generated when the guest
+// reads them, and file sectors are read from the host file at that point.
+// Sectors the guest writes go to an in-memory overlay that takes precedence
+// over the generated contents, so the host directory is never modified.
+// WIN-S writes the whole volume, overlay included, to <dir>.img.
+//
+// Layout: one partition at LBA 63 on a 16-head, 63-sector geometry, FAT16 with
+// 512 root entries. The volume is sized for the payload plus at least 16MB of
+// free space, in 32MB steps up to 480MB so CHS stays below 1024 cylinders.
+// Names are mapped to upper-case 8.3, with ~N added where they collide.
+//
+// driver_sd fetches sectors through the vdisk_read_dword/vdisk_write_dword
+// DPI functions instead of disk_read_dword/disk_write_dword (disk.cpp) when a
+// virtual disk is mounted.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
+
+#include "vdisk.h"
+#include "log.h"
+
+using namespace std;
+
+static const uint32_t PART_START   = 63;
+static const uint32_t HEADS        = 16;
+static const uint32_t SPT          = 63;
+static const uint32_t ROOT_ENTRIES = 512;
+static const uint32_t ROOT_SECTORS = ROOT_ENTRIES * 32 / 512;
+static const uint32_t STEP_MB      = 32;
+static const uint32_t MAX_MB       = 480;
+static const uint32_t MIN_FREE_MB  = 16;
+
+struct Node {
+    string host;                // path on the host
+    char name[11];              // 8.3, space padded
+    bool dir;
+    uint32_t size;
+    uint16_t time, date;
+    int parent;
+    vector<int> children;
+    uint32_t first, clusters;   // cluster run, 0 for the root and empty files
+};
+
+static bool active;
+static string root_dir;
+static vector<Node> nodes;      // nodes[0] is the root directory
+static vector<int> by_cluster;  // nodes with clusters, in cluster order
+
+static uint32_t total_sectors, part_sectors;
+static uint32_t spc, fat_sectors, cluster_count;
+static uint32_t fat_start, root_start, data_start;
+
+static unordered_map<uint32_t, array<uint8_t, 512>> overlay;
+
+// driver_sd moves a dword at a time, so keep the sector it is working on
+static uint32_t cache_lba = ~0u;
+static uint8_t cache[512];
+
+bool vdisk_active() {
+    return active;
+}
+
+uint64_t vdisk_bytes() {
+    return (uint64_t)total_sectors * 512;
+}
+
+//------------------------------------------------------------------------------ scan
+
+static void dos_time(time_t t, uint16_t *time, uint16_t *date) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    if (tm.tm_year < 80) { *time = 0; *date = (1 << 5) | 1; return; }
+    *time = tm.tm_hour << 11 | tm.tm_min << 5 | tm.tm_sec / 2;
+    *date = (tm.tm_year - 80) << 9 | (tm.tm_mon + 1) << 5 | tm.tm_mday;
+}
+
+static string dos_chars(const string &s, size_t max) {
+    string r;
+    for (char c : s) {
+        if (r.size() == max) break;
+        c = toupper((unsigned char)c);
+        if (isalnum((unsigned char)c) || strchr("!#$%&'()-@^_`{}~", c)) r += c;
+    }
+    return r;
+}
+
+// 8.3 name for `host`, unique among the siblings already in `dir`
+static void short_name(const string &host, const Node &dir, char out[11]) {
+    size_t dot = host.find_last_of('.');
+    string base = dos_chars(dot == string::npos || dot == 0 ? host : host.substr(0, dot), 8);
+    string ext = dot == string::npos || dot == 0 ? "" : dos_chars(host.substr(dot + 1), 3);
+    if (base.empty()) base = "_";
+    for (int n = 0; ; n++) {
+        string b = base;
+        if (n) {
+            string suffix = "~" + to_string(n);
+            b = base.substr(0, 8 - suffix.size()) + suffix;
+        }
+        char name[11];
+        memset(name, ' ', 11);
+        memcpy(name, b.data(), b.size());
+        memcpy(name + 8, ext.data(), ext.size());
+        bool taken = false;
+        for (int c : dir.children)
+            if (!memcmp(nodes[c].name, name, 11)) taken = true;
+        if (!taken) { memcpy(out, name, 11); return; }
+    }
+}
+
+static void scan(int index) {
+    DIR *d = opendir(nodes[index].host.c_str());
+    if (!d) { perror(nodes[index].host.c_str()); return; }
+    vector<string> names;
+    while (struct dirent *e = readdir(d))
+        if (e->d_name[0] != '.') names.push_back(e->d_name);
+    closedir(d);
+    sort(names.begin(), names.end());       // stable 8.3 names across runs
+
+    for (const string &n : names) {
+        Node node = {};
+        node.host = nodes[index].host + "/" + n;
+        struct stat st;
+        if (stat(node.host.c_str(), &st) != 0) continue;
+        node.dir = S_ISDIR(st.st_mode);
+        if (!node.dir && (!S_ISREG(st.st_mode) || st.st_size >= (off_t)MAX_MB << 20)) continue;
+        if (index == 0 && nodes[0].children.size() == ROOT_ENTRIES - 1) {
+            printf("VDISK: more than %u entries in %s, ignoring %s\n", ROOT_ENTRIES - 1, root_dir.c_str(), n.c_str());
+            continue;
+        }
+        node.size = node.dir ? 0 : st.st_size;
+        node.parent = index;
+        dos_time(st.st_mtime, &node.time, &node.date);
+        short_name(n, nodes[index], node.name);
+        nodes.push_back(node);
+        int child = nodes.size() - 1;
+        nodes[index].children.push_back(child);
+        if (node.dir) scan(child);
+    }
+}
+
+//------------------------------------------------------------------------------ layout
+
+// Place the clusters of every node for a volume of `mb` megabytes. Returns
+// false if it does not fit with the minimum free space.
+static bool layout(uint32_t mb) {
+    uint32_t cylinders = ((uint64_t)mb << 20) / 512 / (HEADS * SPT);
+    total_sectors = cylinders * HEADS * SPT;
+    part_sectors = total_sectors - PART_START;
+
+    for (spc = 4; ; spc *= 2) {
+        fat_sectors = (((part_sectors - 1 - ROOT_SECTORS) / spc + 2) * 2 + 511) / 512;
+        cluster_count = (part_sectors - 1 - ROOT_SECTORS - 2 * fat_sectors) / spc;
+        if (cluster_count <= 65524) break;
+    }
+    fat_start = PART_START + 1;
+    root_start = fat_start + 2 * fat_sectors;
+    data_start = root_start + ROOT_SECTORS;
+
+    uint32_t cluster_bytes = spc * 512, next = 2;
+    by_cluster.clear();
+    for (size_t i = 1; i < nodes.size(); i++) {
+        Node &n = nodes[i];
+        uint32_t bytes = n.dir ? (n.children.size() + 2) * 32 : n.size;
+        n.clusters = (bytes + cluster_bytes - 1) / cluster_bytes;
+        n.first = n.clusters ? next : 0;
+        next += n.clusters;
+        if (n.clusters) by_cluster.push_back(i);
+    }
+    uint32_t free_clusters = next - 2 > cluster_count ? 0 : cluster_count - (next - 2);
+    return (uint64_t)free_clusters * cluster_bytes >= (uint64_t)MIN_FREE_MB << 20;
+}
+
+bool vdisk_open(const char *dir) {
+    root_dir = dir;
+    while (root_dir.size() > 1 && root_dir.back() == '/') root_dir.pop_back();
+    struct stat st;
+    if (stat(root_dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        printf("VDISK: %s is not a directory\n", dir);
+        return false;
+    }
+    nodes.clear();
+    nodes.push_back(Node{root_dir, {}, true, 0, 0, 0, -1, {}, 0, 0});
+    scan(0);
+
+    uint32_t mb = STEP_MB;
+    while (!layout(mb)) {
+        mb += STEP_MB;
+        if (mb > MAX_MB) {
+            printf("VDISK: %s does not fit in a %uMB volume\n", dir, MAX_MB);
+            return false;
+        }
+    }
+    active = true;
+    printf("VDISK: %s as a %uMB FAT16 disk, %zu files and directories, %u-sector clusters\n",
+           root_dir.c_str(), mb, nodes.size() - 1, spc);
+    return true;
+}
+
+//------------------------------------------------------------------------------ sector synthesis
+
+static void put16(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; }
+static void put32(uint8_t *p, uint32_t v) { put16(p, v); put16(p + 2, v >> 16); }
+
+// packed CHS of an LBA on the fixed geometry
+static void chs(uint8_t *p, uint32_t lba) {
+    uint32_t cyl = lba / (HEADS * SPT), head = lba / SPT % HEADS, sec = lba % SPT + 1;
+    p[0] = head;
+    p[1] = sec | (cyl >> 8 & 3) << 6;
+    p[2] = cyl;
+}
+
+static const uint8_t no_boot[] = {0xCD, 0x18, 0xF4, 0xEB, 0xFD};    // int 18h; hlt; jmp $-1
+
+static void gen_mbr(uint8_t *s) {
+    memcpy(s, no_boot, sizeof(no_boot));
+    uint8_t *e = s + 0x1BE;
+    e[0] = 0x80;
+    chs(e + 1, PART_START);
+    e[4] = part_sectors < 65536 ? 0x04 : 0x06;
+    chs(e + 5, total_sectors - 1);
+    put32(e + 8, PART_START);
+    put32(e + 12, part_sectors);
+    s[510] = 0x55; s[511] = 0xAA;
+}
+
+static void gen_boot(uint8_t *s) {
+    s[0] = 0xEB; s[1] = 0x3C; s[2] = 0x90;
+    memcpy(s + 3, "AO486SIM", 8);
+    put16(s + 11, 512);
+    s[13] = spc;
+    put16(s + 14, 1);                   // reserved sectors
+    s[16] = 2;                          // FATs
+    put16(s + 17, ROOT_ENTRIES);
+    put16(s + 19, part_sectors < 65536 ? part_sectors : 0);
+    s[21] = 0xF8;
+    put16(s + 22, fat_sectors);
+    put16(s + 24, SPT);
+    put16(s + 26, HEADS);
+    put32(s + 28, PART_START);
+    put32(s + 32, part_sectors < 65536 ? 0 : part_sectors);
+    s[36] = 0x80;
+    s[38] = 0x29;
+    put32(s + 39, 0x486D15C0);
+    memcpy(s + 43, "HOSTDIR    ", 11);
+    memcpy(s + 54, "FAT16   ", 8);
+    memcpy(s + 62, no_boot, sizeof(no_boot));
+    s[510] = 0x55; s[511] = 0xAA;
+}
+
+// node owning a cluster, or -1 for a free one
+static int owner(uint32_t cluster) {
+    auto it = upper_bound(by_cluster.begin(), by_cluster.end(), cluster,
+                          [](uint32_t c, int n) { return c < nodes[n].first; });
+    if (it == by_cluster.begin()) return -1;
+    const Node &n = nodes[*(it - 1)];
+    return cluster < n.first + n.clusters ? *(it - 1) : -1;
+}
+
+static void gen_fat(uint8_t *s, uint32_t index) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = index * 256 + i, v = 0;
+        if (c == 0) v = 0xFFF8;
+        else if (c == 1) v = 0xFFFF;
+        else if (c < cluster_count + 2) {
+            int n = owner(c);
+            if (n >= 0) v = c + 1 < nodes[n].first + nodes[n].clusters ? c + 1 : 0xFFFF;
+        }
+        put16(s + i * 2, v);
+    }
+}
+
+static void dir_entry(uint8_t *e, const char name[11], uint8_t attr, const Node &n, uint32_t first, uint32_t size) {
+    memcpy(e, name, 11);
+    e[11] = attr;
+    put16(e + 22, n.time);
+    put16(e + 24, n.date);
+    put16(e + 26, first);
+    put32(e + 28, size);
+}
+
+// 16 directory entries starting at entry `index` of directory node `d`
+static void gen_dir(uint8_t *s, int d, uint32_t index) {
+    const Node &dir = nodes[d];
+    uint32_t special = d == 0 ? 1 : 2;     // volume label, or "." and ".."
+    for (uint32_t i = 0; i < 16; i++, index++) {
+        uint8_t *e = s + i * 32;
+        if (d == 0 && index == 0) {
+            dir_entry(e, "HOSTDIR    ", 0x08, dir, 0, 0);
+            continue;
+        }
+        if (d != 0 && index < 2) {
+            const Node &target = index == 0 ? dir : nodes[dir.parent];
+            dir_entry(e, index == 0 ? ".          " : "..         ", 0x10, target, target.first, 0);
+            continue;
+        }
+        uint32_t c = index - special;
+        if (c >= dir.children.size()) return;
+        const Node &n = nodes[dir.children[c]];
+        dir_entry(e, n.name, n.dir ? 0x10 : 0x20, n, n.first, n.size);
+    }
+}
+
+static int data_fd = -1;
+static int data_node = -1;
+
+static void gen_data(uint8_t *s, uint32_t lba) {
+    uint32_t cluster = (lba - data_start) / spc + 2;
+    int n = owner(cluster);
+    if (n < 0) return;
+    uint32_t offset = (cluster - nodes[n].first) * spc * 512 + (lba - data_start) % spc * 512;
+    if (nodes[n].dir) {
+        gen_dir(s, n, offset / 32);
+        return;
+    }
+    if (n != data_node) {
+        if (data_fd >= 0) close(data_fd);
+        data_fd = open(nodes[n].host.c_str(), O_RDONLY);
+        data_node = n;
+    }
+    if (data_fd < 0 || pread(data_fd, s, 512, offset) < 0)
+        LOG(CAT_DISK, LVL_ERROR, "VDISK: cannot read %s\n", nodes[n].host.c_str());
+}
+
+void vdisk_read(uint32_t lba, uint8_t *buf) {
+    auto o = overlay.find(lba);
+    if (o != overlay.end()) {
+        memcpy(buf, o->second.data(), 512);
+        return;
+    }
+    memset(buf, 0, 512);
+    if (lba == 0)
+        gen_mbr(buf);
+    else if (lba == PART_START)
+        gen_boot(buf);
+    else if (lba >= fat_start && lba < root_start)
+        gen_fat(buf, (lba - fat_start) % fat_sectors);
+    else if (lba >= root_start && lba < data_start)
+        gen_dir(buf, 0, (lba - root_start) * 16);
+    else if (lba >= data_start && lba < total_sectors)
+        gen_data(buf, lba);
+}
+
+void vdisk_write(uint32_t lba, const uint8_t *buf) {
+    if (lba >= total_sectors) return;
+    memcpy(overlay[lba].data(), buf, 512);
+    if (lba == cache_lba)
+        memcpy(cache, buf, 512);
+}
+
+void vdisk_persist() {
+    string name = root_dir + ".img";
+    FILE *f = fopen(name.c_str(), "wb");
+    if (!f) {
+        LOG(CAT_SIM, LVL_ERROR, "Failed to open %s for writing\n", name.c_str());
+        return;
+    }
+    uint8_t buf[512];
+    for (uint32_t lba = 0; lba < total_sectors; lba++) {
+        vdisk_read(lba, buf);
+        if (fwrite(buf, 1, 512, f) != 512) {
+            LOG(CAT_SIM, LVL_ERROR, "Failed to write %s\n", name.c_str());
+            break;
+        }
+    }
+    fclose(f);
+    LOG(CAT_SIM, LVL_INFO, "Virtual disk written to %s (%zu sectors from the overlay)\n", name.c_str(), overlay.size());
+}
+
+//------------------------------------------------------------------------------ driver_sd DPI
+
+extern "C" int vdisk_enabled() {
+    return active;
+}
+
+extern "C" unsigned int vdisk_read_dword(unsigned int addr) {
+    uint32_t lba = addr / 512;
+    if (lba != cache_lba) {
+        vdisk_read(lba, cache);
+        cache_lba = lba;
+    }
+    uint32_t v;
+    memcpy(&v, cache + (addr & 511 & ~3u), 4);
+    return v;
+}
+
+extern "C" void vdisk_write_dword(unsigned int addr, unsigned int data) {
+    uint32_t lba = addr / 512;
+    if (lba >= total_sectors) return;
+    auto o = overlay.find(lba);
+    if (o == overlay.end()) {
+        uint8_t buf[512];
+        vdisk_read(lba, buf);
+        o = overlay.emplace(lba, array<uint8_t, 512>()).first;
+        memcpy(o->second.data(), buf, 512);
+    }
+    memcpy(o->second.data() + (addr & 511 & ~3u), &data, 4);
+    if (lba == cache_lba)
+        memcpy(cache + (addr & 511 & ~3u), &data, 4);
+}
+
+#ifdef SIM_SAVABLE
+
+// the overlay only; the generated sectors come from the same --vdisk directory
+void vdisk_save(VerilatedSerialize &os) {
+    uint32_t count = overlay.size();
+    os << count;
+    for (auto &o : overlay) {
+        uint32_t lba = o.first;
+        os << lba;
+        os.write(o.second.data(), 512);
+    }
+}
+
+bool vdisk_restore(VerilatedDeserialize &os) {
+    uint32_t count;
+    os >> count;
+    overlay.clear();
+    cache_lba = ~0u;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t lba;
+        os >> lba;
+        os.read(overlay[lba].data(), 512);
+    }
+    if (count && !active) {
+        printf("Snapshot has a virtual disk overlay, run it with the same --vdisk\n");
+        return false;
+    }
+    return true;
+}
+
+#endif
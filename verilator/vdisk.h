@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host directory presented as a FAT16 hard disk, see vdisk.cpp
+bool vdisk_open(const char *dir);
+bool vdisk_active();
+uint64_t vdisk_bytes();
+void vdisk_read(uint32_t lba, uint8_t *buf);
+void vdisk_write(uint32_t lba, const uint8_t *buf);
+void vdisk_persist();
+
+class VerilatedSerialize;
+class VerilatedDeserialize;
+void vdisk_save(VerilatedSerialize &os);
+bool vdisk_restore(VerilatedDeserialize &os);
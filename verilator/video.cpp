@@ -0,0 +1,157 @@
+// Background recording of the guest display (--record-video <file>).
+//
+// Each completed frame is cropped to the current resolution and hashed. A
+// frame equal to the previous one only bumps a repeat count; a new one is
+// copied into a small queue that an encoder thread drains. If the queue is
+// full the frame is dropped and counted, so the simulation never waits for
+// the disk.
+//
+// The file is a plain sequence of binary PPM (P6) images. A frame identical
+// to the previous one is not written again: every image stands for a run of
+// equal frames, and its header says how long the run lasted:
+//   P6
+//   # frame <first frame number> time <sim_time> repeat <frames in the run>
+//   <width> <height>
+//   255
+// Any tool reading concatenated PPMs can play it, e.g.
+//   ffmpeg -f image2pipe -c:v ppm -i video.ppm video.mkv
+// shows each distinct screen once; the repeat counts give the real timing.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "video.h"
+#include "log.h"
+
+extern uint64_t sim_time;
+extern int frame_count;
+
+bool video_recording;
+
+static const size_t QUEUE_FRAMES = 8;
+
+struct Frame {
+    int width, height;
+    int number;
+    uint64_t time;
+    int repeat;
+    std::vector<uint8_t> rgb;       // empty: more repeats of the previous frame
+};
+
+static FILE *out;
+static std::thread encoder;
+static std::mutex lock;
+static std::condition_variable queued;
+static std::deque<Frame> queue;
+static bool closing;
+static uint64_t last_hash;
+static uint64_t repeated, dropped;
+
+// encoder thread state
+static Frame pending;               // written when its run ends
+static int pending_repeat;
+static uint64_t written;
+
+static void write_pending() {
+    if (!pending_repeat) return;
+    fprintf(out, "P6\n# frame %d time %llu repeat %d\n%d %d\n255\n", pending.number,
+            (unsigned long long)pending.time, pending_repeat, pending.width, pending.height);
+    fwrite(pending.rgb.data(), 1, pending.rgb.size(), out);
+    written++;
+}
+
+static void encode(Frame &f) {
+    if (f.rgb.empty()) {
+        pending_repeat += f.repeat;
+        return;
+    }
+    write_pending();
+    pending_repeat = f.repeat;
+    pending = std::move(f);
+}
+
+static void encoder_main() {
+    std::unique_lock<std::mutex> l(lock);
+    for (;;) {
+        queued.wait(l, [] { return closing || !queue.empty(); });
+        if (queue.empty()) break;
+        Frame f = std::move(queue.front());
+        queue.pop_front();
+        l.unlock();
+        encode(f);
+        l.lock();
+    }
+    write_pending();
+}
+
+bool video_open(const char *filename) {
+    out = fopen(filename, "wb");
+    if (!out) {
+        perror(filename);
+        return false;
+    }
+    video_recording = true;
+    encoder = std::thread(encoder_main);
+    atexit(video_close);            // also on early exits, a running thread must be joined
+    return true;
+}
+
+// pixels are main.cpp's screenbuffer: 4 bytes per pixel, A B G R
+void video_frame(const uint8_t *pixels, int stride, int width, int height) {
+    uint64_t h = 14695981039346656037ull ^ ((uint64_t)width << 32 | height);
+    for (int y = 0; y < height; y++) {
+        const uint64_t *s = (const uint64_t *)(pixels + (size_t)y * stride * 4);
+        for (int x = 0; x < width / 2; x++)
+            h = (h ^ s[x]) * 1099511628211ull;
+    }
+
+    std::lock_guard<std::mutex> l(lock);
+    if (h == last_hash) {
+        repeated++;
+        if (!queue.empty())
+            queue.back().repeat++;
+        else
+            queue.push_back({width, height, frame_count, sim_time, 1});
+        queued.notify_one();
+        return;
+    }
+    if (queue.size() >= QUEUE_FRAMES) {
+        dropped++;
+        return;
+    }
+    last_hash = h;
+    Frame f = {width, height, frame_count, sim_time, 1};
+    f.rgb.resize((size_t)width * height * 3);
+    uint8_t *d = f.rgb.data();
+    for (int y = 0; y < height; y++) {
+        const uint8_t *s = pixels + (size_t)y * stride * 4;
+        for (int x = 0; x < width; x++, s += 4, d += 3) {
+            d[0] = s[3];
+            d[1] = s[2];
+            d[2] = s[1];
+        }
+    }
+    queue.push_back(std::move(f));
+    queued.notify_one();
+}
+
+void video_close() {
+    if (!video_recording) return;
+    {
+        std::lock_guard<std::mutex> l(lock);
+        closing = true;
+        queued.notify_one();
+    }
+    encoder.join();
+    fclose(out);
+    video_recording = false;
+    LOG(CAT_FRAME, LVL_INFO, "Video: %llu images written, %llu repeated frames skipped, %llu dropped\n",
+        (unsigned long long)written, (unsigned long long)repeated, (unsigned long long)dropped);
+}
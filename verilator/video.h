@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// Background recording of the guest display, see video.cpp
+extern bool video_recording;
+
+bool video_open(const char *filename);
+void video_frame(const uint8_t *pixels, int stride, int width, int height);
+void video_close();
@@ -0,0 +1,213 @@
+// Watchdog that ends batch runs whose guest has crashed or hung.
+//
+// --watchdog [N] turns it on. It stops the simulation with a short
+// post-mortem (CS:EIP, registers, the last I/O operations) and exits with:
+//   122  shutdown, i.e. the CPU took a triple fault
+//   121  HLT with interrupts disabled, which only a reset would end
+//   120  no forward progress for a window of N time units (same unit as
+//        -s/-e, default 200M): no instruction retired at all, or the CPU
+//        stayed within fewer than 16 distinct EIPs with no I/O, no HLT and
+//        no change on screen.
+// EIPs and I/O inside hardware interrupt handlers do not count, nor do EOIs
+// to the PIC: the timer interrupt alone would otherwise make a guest stuck
+// in JMP $ with interrupts enabled look alive. An idle guest waiting for a
+// key normally sits in HLT, which is not a hang. A handler is tracked from
+// its first instruction until the stack pointer is back above where it was
+// then, i.e. its IRET, or the stack is switched away from it.
+// These statuses are only distinct if the guest's own exit port codes
+// (hostio.cpp) stay out of 120-122.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <bitset>
+
+#include "Vsystem.h"
+#include "Vsystem_ao486.h"
+#include "Vsystem_system.h"
+#include "Vsystem_pipeline.h"
+#include "Vsystem_write.h"
+#include "Vsystem_exception.h"
+
+#include "watchdog.h"
+#include "log.h"
+
+extern Vsystem tb;
+extern uint64_t sim_time;
+
+bool watchdog_enabled;
+
+static const size_t MIN_EIPS = 16;
+static const uint64_t CLI_HLT_TIME = 1000;      // debounce, sim_time units
+
+// first micro-op commands, src/ao486/autogen/defines.v
+static const uint8_t CMD_int = 28;
+
+static uint64_t window = 200000000;
+static int exit_code;
+
+// current window
+static uint64_t window_start, retired_start;
+static uint64_t io_ops;
+static bool screen_changed, halted;
+static std::bitset<4096> eips;                  // hashed, approximate count
+static size_t eip_count;
+
+static uint32_t eip_r;
+static bool io_write_r, io_read_r;
+static uint64_t cli_hlt_since;
+static const int SCREEN_HASHES = 4;
+static uint64_t screen_hashes[SCREEN_HASHES];   // recent distinct screens
+
+// hardware interrupt handlers running, innermost last: the stack they
+// started with
+struct Handler {
+    uint16_t ss;
+    uint32_t esp;
+};
+static const int MAX_HANDLERS = 16;
+static Handler handlers[MAX_HANDLERS];
+static int handler_count;
+static bool irq_entering;                       // acknowledged, entry not retired yet
+static uint64_t retired_r;
+
+struct IoOp {
+    uint64_t time;
+    bool write;
+    uint16_t port;
+    uint32_t data;
+    uint8_t length;
+};
+static const int IO_HISTORY = 16;
+static IoOp io_history[IO_HISTORY];
+static uint64_t io_total;
+
+void watchdog_set_window(uint64_t w) {
+    watchdog_enabled = true;
+    if (w) window = w;
+}
+
+int watchdog_exit_code() {
+    return exit_code;
+}
+
+static void record_io(bool write, uint16_t port, uint32_t data, uint8_t length) {
+    io_history[io_total++ % IO_HISTORY] = {sim_time, write, port, data, length};
+    bool eoi = write && (port == 0x20 || port == 0xA0);
+    if (!handler_count && !eoi) io_ops++;
+}
+
+// Follow hardware interrupt handlers by their stack
+static void track_handlers() {
+    Vsystem_system *sys = tb.system;
+    Vsystem_pipeline *p = sys->ao486->pipeline_inst;
+    if (sys->interrupt_done) irq_entering = true;
+
+    uint64_t retired = p->write_inst->retired;
+    if (retired == retired_r) return;
+    retired_r = retired;
+    while (handler_count) {
+        const Handler &h = handlers[handler_count - 1];
+        if (p->ss == h.ss && p->esp <= h.esp) break;
+        handler_count--;
+    }
+    if (irq_entering && p->write_inst->retired_cmd == CMD_int) {
+        irq_entering = false;
+        if (handler_count == MAX_HANDLERS) {
+            memmove(handlers, handlers + 1, sizeof(Handler) * (MAX_HANDLERS - 1));
+            handler_count--;
+        }
+        handlers[handler_count++] = {p->ss, p->esp};
+    }
+}
+
+// Pixels of a finished frame. A screen seen in the last few distinct ones is
+// not a change, so that a blinking cursor or blinking text is not progress.
+void watchdog_frame(const void *pixels, size_t bytes) {
+    if (!watchdog_enabled) return;
+    const uint64_t *p = (const uint64_t *)pixels;
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < bytes / 8; i++)
+        h = (h ^ p[i]) * 1099511628211ull;
+    for (uint64_t s : screen_hashes)
+        if (s == h) return;
+    screen_changed = true;
+    memmove(screen_hashes + 1, screen_hashes, sizeof(uint64_t) * (SCREEN_HASHES - 1));
+    screen_hashes[0] = h;
+}
+
+static bool trip(int code, const char *reason) {
+    Vsystem_ao486 *cpu = tb.system->ao486;
+    Vsystem_pipeline *p = cpu->pipeline_inst;
+    exit_code = code;
+    log_printf("%8lld: WATCHDOG: %s, exit status %d\n", sim_time, reason, code);
+    log_printf("  CS:EIP=%04x:%08x, %llu instructions retired\n", p->cs, cpu->eip,
+               (unsigned long long)p->write_inst->retired);
+    log_printf("  EAX=%08x EBX=%08x ECX=%08x EDX=%08x\n", p->eax, p->ebx, p->ecx, p->edx);
+    log_printf("  ESI=%08x EDI=%08x EBP=%08x ESP=%08x\n", p->esi, p->edi, p->ebp, p->esp);
+    log_printf("  DS=%04x ES=%04x FS=%04x GS=%04x SS=%04x\n", p->ds, p->es, p->fs, p->gs, p->ss);
+    log_printf("  last I/O operations:\n");
+    for (uint64_t i = io_total > IO_HISTORY ? io_total - IO_HISTORY : 0; i < io_total; i++) {
+        const IoOp &op = io_history[i % IO_HISTORY];
+        if (op.write)
+            log_printf("  %8lld: OUT %04x, %0*x\n", op.time, op.port, op.length * 2,
+                       op.length >= 4 ? op.data : op.data & ((1u << (op.length * 8)) - 1));
+        else
+            log_printf("  %8lld: IN  %04x\n", op.time, op.port);
+    }
+    return true;
+}
+
+// Called once per clock. Returns true when the simulation should stop.
+bool watchdog_check() {
+    Vsystem_ao486 *cpu = tb.system->ao486;
+
+    bool io_write = tb.system->cpu_io_write_do, io_read = tb.system->cpu_io_read_do;
+    if (io_write && !io_write_r)
+        record_io(true, tb.system->cpu_io_write_address, tb.system->cpu_io_write_data, tb.system->cpu_io_write_length);
+    if (io_read && !io_read_r)
+        record_io(false, tb.system->cpu_io_read_address, 0, 0);
+    io_write_r = io_write;
+    io_read_r = io_read;
+
+    track_handlers();
+    if (cpu->pipeline_inst->write_inst->halted) halted = true;
+
+    if (cpu->eip != eip_r && !handler_count) {
+        eip_r = cpu->eip;
+        size_t h = (eip_r * 2654435761u) >> 20;
+        if (!eips[h]) { eips[h] = true; eip_count++; }
+    }
+
+    if (cpu->exception_inst->shutdown)
+        return trip(WATCHDOG_EXIT_SHUTDOWN, "shutdown (triple fault)");
+
+    if (!cpu->pipeline_inst->write_inst->halted_cli || cli_hlt_since > sim_time)
+        cli_hlt_since = 0;
+    else if (!cli_hlt_since)
+        cli_hlt_since = sim_time;
+    else if (sim_time - cli_hlt_since > CLI_HLT_TIME)
+        return trip(WATCHDOG_EXIT_CLI_HLT, "HLT with interrupts disabled");
+
+    uint64_t retired = cpu->pipeline_inst->write_inst->retired;
+    if (!window_start || sim_time < window_start) {     // first call, after --load or a rewind
+        window_start = sim_time;
+        retired_start = retired;
+        handler_count = 0;
+        irq_entering = false;
+    }
+    if (sim_time - window_start < window)
+        return false;
+    if (retired == retired_start)
+        return trip(WATCHDOG_EXIT_NO_PROGRESS, "no instruction retired");
+    if (eip_count < MIN_EIPS && io_ops == 0 && !halted && !screen_changed)
+        return trip(WATCHDOG_EXIT_NO_PROGRESS, "looping without I/O or screen changes");
+    window_start = sim_time;
+    retired_start = retired;
+    io_ops = 0;
+    screen_changed = false;
+    halted = false;
+    eips.reset();
+    eip_count = 0;
+    return false;
+}
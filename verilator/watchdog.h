@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hang and crash watchdog, see watchdog.cpp
+const int WATCHDOG_EXIT_NO_PROGRESS = 120;
+const int WATCHDOG_EXIT_CLI_HLT     = 121;
+const int WATCHDOG_EXIT_SHUTDOWN    = 122;
+
+extern bool watchdog_enabled;
+
+void watchdog_set_window(uint64_t window);
+bool watchdog_check();
+void watchdog_frame(const void *pixels, size_t bytes);
+int watchdog_exit_code();